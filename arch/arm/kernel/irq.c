@@ -37,6 +37,8 @@
 #include <linux/proc_fs.h>
 #include <linux/ftrace.h>
 
+#include <eventlogging/events.h>
+
 #include <asm/system.h>
 #include <asm/mach/arch.h>
 #include <asm/mach/irq.h>
@@ -79,6 +81,7 @@ asm_do_IRQ(unsigned int irq, struct pt_regs *regs)
 	struct pt_regs *old_regs = set_irq_regs(regs);
 
 	irq_enter();
+	event_log_hardirq_entry(irq);
 
 	/*
 	 * Some hardware gives randomly wrong interrupts.  Rather
@@ -95,6 +98,7 @@ asm_do_IRQ(unsigned int irq, struct pt_regs *regs)
 	/* AT91 specific workaround */
 	irq_finish(irq);
 
+	event_log_hardirq_exit(irq);
 	irq_exit();
 	set_irq_regs(old_regs);
 }
@@ -40,6 +40,8 @@
 #include <asm/ptrace.h>
 #include <asm/localtimer.h>
 
+#include <eventlogging/events.h>
+
 /*
  * as from 2.5, kernels no longer have an init_tasks structure
  * so we need some other way of telling a new secondary core
@@ -463,12 +465,23 @@ asmlinkage void __exception_irq_entry do_local_timer(struct pt_regs *regs)
 {
 	struct pt_regs *old_regs = set_irq_regs(regs);
 	int cpu = smp_processor_id();
+	unsigned int irq = __get_cpu_var(percpu_clockevent).irq;
+
+	/*
+	 * The local timer doesn't go through asm_do_IRQ(); log it here, in
+	 * hardirq context as asm_do_IRQ() does.  ipi_timer() nests its own
+	 * irq_enter(), so softirqs still run after the exit is logged.
+	 */
+	irq_enter();
+	event_log_hardirq_entry(irq);
 
 	if (local_timer_ack()) {
 		__inc_irq_stat(cpu, local_timer_irqs);
 		ipi_timer();
 	}
 
+	event_log_hardirq_exit(irq);
+	irq_exit();
 	set_irq_regs(old_regs);
 }
 
@@ -623,6 +636,13 @@ asmlinkage void __exception_irq_entry do_IPI(int ipinr, struct pt_regs *regs)
 	unsigned int cpu = smp_processor_id();
 	struct pt_regs *old_regs = set_irq_regs(regs);
 
+	/*
+	 * IPIs don't go through asm_do_IRQ(); log them here, in hardirq
+	 * context as asm_do_IRQ() does.  ipinr is the SGI number.
+	 */
+	irq_enter();
+	event_log_hardirq_entry(ipinr);
+
 	if (ipinr >= IPI_TIMER && ipinr < IPI_TIMER + NR_IPI)
 		__inc_irq_stat(cpu, ipi_irqs[ipinr - IPI_TIMER]);
 
@@ -656,6 +676,8 @@ asmlinkage void __exception_irq_entry do_IPI(int ipinr, struct pt_regs *regs)
 		       cpu, ipinr);
 		break;
 	}
+	event_log_hardirq_exit(ipinr);
+	irq_exit();
 	set_irq_regs(old_regs);
 }
 
@@ -20,6 +20,8 @@
 #include <linux/highmem.h>
 #include <linux/perf_event.h>
 
+#include <eventlogging/events.h>
+
 #include <asm/system.h>
 #include <asm/pgtable.h>
 #include <asm/tlbflush.h>
@@ -272,6 +274,33 @@ out:
 	return fault;
 }
 
+/*
+ * Logs the end of a fault, classified as major or minor and file-backed
+ * or anonymous.  Must be called with mmap_sem held.
+ */
+static inline void
+log_page_fault_exit(struct mm_struct *mm, unsigned long addr, unsigned int fsr,
+		    int fault, struct pt_regs *regs)
+{
+#ifdef CONFIG_EVENT_PAGE_FAULT_EXIT
+	struct vm_area_struct *vma;
+	u8 flags = 0;
+
+	if (fault & VM_FAULT_MAJOR)
+		flags |= PAGE_FAULT_MAJOR;
+	if (fsr & FSR_WRITE)
+		flags |= PAGE_FAULT_WRITE;
+	if (user_mode(regs))
+		flags |= PAGE_FAULT_USER;
+	if (fault & (VM_FAULT_ERROR | VM_FAULT_BADMAP | VM_FAULT_BADACCESS))
+		flags |= PAGE_FAULT_ERROR;
+	vma = find_vma(mm, addr);
+	if (vma && vma->vm_start <= addr && vma->vm_file)
+		flags |= PAGE_FAULT_FILE;
+	event_log_page_fault_exit(addr, flags);
+#endif
+}
+
 static int __kprobes
 do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 {
@@ -292,6 +321,8 @@ do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 	if (in_atomic() || !mm)
 		goto no_context;
 
+	event_log_page_fault_entry(addr);
+
 	/*
 	 * As per x86, we may deadlock here.  However, since the kernel only
 	 * validly references user space from well defined areas of the code,
@@ -299,7 +330,7 @@ do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 	 */
 	if (!down_read_trylock(&mm->mmap_sem)) {
 		if (!user_mode(regs) && !search_exception_tables(regs->ARM_pc))
-			goto no_context;
+			goto no_context_exit;
 		down_read(&mm->mmap_sem);
 	} else {
 		/*
@@ -311,11 +342,12 @@ do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 #ifdef CONFIG_DEBUG_VM
 		if (!user_mode(regs) &&
 		    !search_exception_tables(regs->ARM_pc))
-			goto no_context;
+			goto no_context_exit;
 #endif
 	}
 
 	fault = __do_page_fault(mm, addr, fsr, tsk);
+	log_page_fault_exit(mm, addr, fsr, fault, regs);
 	up_read(&mm->mmap_sem);
 
 	perf_sw_event(PERF_COUNT_SW_PAGE_FAULTS, 1, 0, regs, addr);
@@ -367,6 +399,9 @@ do_page_fault(unsigned long addr, unsigned int fsr, struct pt_regs *regs)
 	__do_user_fault(tsk, addr, fsr, sig, code, regs);
 	return 0;
 
+no_context_exit:
+	/* bailed out after the entry was logged, without taking the fault */
+	event_log_page_fault_exit(addr, PAGE_FAULT_ERROR);
 no_context:
 	__do_kernel_fault(mm, addr, fsr, regs);
 	return 0;
@@ -1837,6 +1837,7 @@ struct request *blk_peek_request(struct request_queue *q)
 			 */
 			rq->cmd_flags |= REQ_STARTED;
 			trace_block_rq_issue(q, rq);
+			blk_event_log_dispatch(rq);
 		}
 
 		if (!q->boundary_rq || q->boundary_rq == rq) {
@@ -2006,6 +2007,7 @@ bool blk_update_request(struct request *req, int error, unsigned int nr_bytes)
 		return false;
 
 	trace_block_rq_complete(req->q, req);
+	blk_event_log_complete(req, error, nr_bytes);
 
 	/*
 	 * For fs requests, rq is just carrier of independent bio's
@@ -1,6 +1,8 @@
 #ifndef BLK_INTERNAL_H
 #define BLK_INTERNAL_H
 
+#include <eventlogging/events.h>
+
 /* Amount of time in which a process may batch requests */
 #define BLK_BATCH_TIME	(HZ/50UL)
 
@@ -23,6 +25,54 @@ void blk_delete_timer(struct request *);
 void blk_add_timer(struct request *);
 void __generic_unplug_device(struct request_queue *);
 
+/*
+ * Event logging of the request lifecycle.  The insert is logged in the
+ * context of the submitting task, which links the request to that
+ * task's EVENT_IO_BLOCK.
+ */
+static inline u8 blk_event_log_flags(struct request *rq, int error)
+{
+	u8 flags = 0;
+
+	if (rq_data_dir(rq) == WRITE)
+		flags |= BLOCK_RQ_WRITE;
+	if (rq_is_sync(rq))
+		flags |= BLOCK_RQ_SYNC;
+	if (rq->cmd_flags & REQ_META)
+		flags |= BLOCK_RQ_META;
+	if (rq->cmd_flags & (REQ_FLUSH | REQ_FUA))
+		flags |= BLOCK_RQ_FLUSH;
+	if (rq->cmd_flags & REQ_DISCARD)
+		flags |= BLOCK_RQ_DISCARD;
+	if (error)
+		flags |= BLOCK_RQ_ERROR;
+	return flags;
+}
+
+static inline u32 blk_event_log_dev(struct request *rq)
+{
+	return rq->rq_disk ? disk_devt(rq->rq_disk) : 0;
+}
+
+static inline void blk_event_log_insert(struct request *rq)
+{
+	event_log_block_rq_insert(rq, blk_event_log_dev(rq), blk_rq_pos(rq),
+				  blk_rq_bytes(rq), blk_event_log_flags(rq, 0));
+}
+
+static inline void blk_event_log_dispatch(struct request *rq)
+{
+	event_log_block_rq_dispatch(rq, blk_event_log_dev(rq), blk_rq_pos(rq),
+				    blk_rq_bytes(rq), blk_event_log_flags(rq, 0));
+}
+
+static inline void blk_event_log_complete(struct request *rq, int error,
+					  unsigned int nr_bytes)
+{
+	event_log_block_rq_complete(rq, blk_event_log_dev(rq), blk_rq_pos(rq),
+				    nr_bytes, blk_event_log_flags(rq, error));
+}
+
 /*
  * Internal atomic flags for request handling
  */
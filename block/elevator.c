@@ -651,6 +651,7 @@ void elv_quiesce_end(struct request_queue *q)
 void __elv_add_request(struct request_queue *q, struct request *rq, int where)
 {
 	trace_block_rq_insert(q, rq);
+	blk_event_log_insert(rq);
 
 	rq->q = q;
 
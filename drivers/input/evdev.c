@@ -24,6 +24,7 @@
 #include <linux/major.h>
 #include <linux/device.h>
 #include <linux/wakelock.h>
+#include <eventlogging/events.h>
 #include "input-compat.h"
 
 struct evdev {
@@ -111,6 +112,8 @@ static void evdev_event(struct input_handle *handle,
 	event.code = code;
 	event.value = value;
 
+	event_log_input_event(evdev->minor, type, code, value);
+
 	rcu_read_lock();
 
 	client = rcu_dereference(evdev->grab);
@@ -428,6 +431,9 @@ static ssize_t evdev_read(struct file *file, char __user *buffer,
 		retval += input_event_size();
 	}
 
+	if (retval > 0)
+		event_log_input_read(evdev->minor, retval / input_event_size());
+
 	if (retval == 0 && file->f_flags & O_NONBLOCK)
 		retval = -EAGAIN;
 	return retval;
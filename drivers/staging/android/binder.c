@@ -19,6 +19,8 @@
 #include <linux/fdtable.h>
 #include <linux/file.h>
 #include <linux/fs.h>
+#include <linux/hash.h>
+#include <linux/ktime.h>
 #include <linux/list.h>
 #include <linux/miscdevice.h>
 #include <linux/mm.h>
@@ -32,12 +34,18 @@
 #include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/uaccess.h>
+#include <linux/uio.h>
 #include <linux/vmalloc.h>
 
 #include <eventlogging/events.h>
 
 #include "binder.h"
 
+/*
+ * binder_lock serializes all binder state: procs, threads, nodes, refs,
+ * transactions, todo lists and each proc's buffer allocator.  It nests
+ * outside mm->mmap_sem.
+ */
 static DEFINE_MUTEX(binder_lock);
 static DEFINE_MUTEX(binder_deferred_lock);
 
@@ -107,6 +115,22 @@ module_param_named(debug_mask, binder_debug_mask, uint, S_IWUSR | S_IRUGO);
 static int binder_debug_no_lock;
 module_param_named(proc_no_lock, binder_debug_no_lock, bool, S_IWUSR | S_IRUGO);
 
+/*
+ * Freed buffer pages are left mapped, up to this many per proc, so that
+ * the next allocation over them doesn't have to take mmap_sem.  Read-only,
+ * as lowering it would not trim the pages procs already cache.
+ */
+static unsigned int binder_cached_pages = 8;
+module_param_named(cached_pages, binder_cached_pages, uint, S_IRUGO);
+
+/*
+ * Keep per (caller, code) stats in procs that receive transactions while
+ * this is set; see debugfs pair_stats.
+ */
+static int binder_pair_stats_enabled;
+module_param_named(pair_stats, binder_pair_stats_enabled, bool,
+		   S_IWUSR | S_IRUGO);
+
 static DECLARE_WAIT_QUEUE_HEAD(binder_user_error_wait);
 static int binder_stop_on_user_error;
 
@@ -149,7 +173,7 @@ enum binder_stat_types {
 
 struct binder_stats {
 	int br[_IOC_NR(BR_FAILED_REPLY) + 1];
-	int bc[_IOC_NR(BC_DEAD_BINDER_DONE) + 1];
+	int bc[_IOC_NR(BC_REPLY_SG) + 1];
 	int obj_created[BINDER_STAT_COUNT];
 	int obj_deleted[BINDER_STAT_COUNT];
 };
@@ -302,10 +326,12 @@ struct binder_proc {
 	size_t free_async_space;
 
 	struct page **pages;
+	unsigned int cached_pages;	/* mapped, but in no buffer */
 	size_t buffer_size;
 	uint32_t buffer_free;
 	struct list_head todo;
 	wait_queue_head_t wait;
+	struct list_head waiting_threads;
 	struct binder_stats stats;
 	struct list_head delivered_death;
 	int max_threads;
@@ -314,6 +340,8 @@ struct binder_proc {
 	int ready_threads;
 	long default_priority;
 	struct dentry *debugfs_entry;
+	struct binder_pair_stats *pair_stats;
+	unsigned int pair_stats_dropped;
 };
 
 enum {
@@ -338,6 +366,14 @@ struct binder_thread {
 		/* we are also waiting on */
 	wait_queue_head_t wait;
 	struct binder_stats stats;
+	struct task_struct *task;
+	struct list_head waiting_node; /* on proc->waiting_threads while idle */
+	int last_server; /* pid of the thread that took our last transaction */
+};
+
+struct binder_priority {
+	unsigned int sched_policy;
+	int prio;	/* rt_priority for SCHED_FIFO and SCHED_RR, else nice */
 };
 
 struct binder_transaction {
@@ -354,9 +390,33 @@ struct binder_transaction {
 	struct binder_buffer *buffer;
 	unsigned int	code;
 	unsigned int	flags;
-	long	priority;
-	long	saved_priority;
+	struct binder_priority	priority;
+	struct binder_priority	saved_priority;
 	uid_t	sender_euid;
+	pid_t	sender_pid;	/* calling proc, even for one-way */
+	ktime_t	start;		/* when queued to the target */
+};
+
+/*
+ * Per (caller proc, code) transaction statistics, kept by the target
+ * proc.  Latencies are measured from queueing the transaction to the
+ * target thread picking it up, and to the reply being sent.
+ */
+#define BINDER_PAIR_STATS_BITS 4
+#define BINDER_PAIR_STATS_SIZE (1 << BINDER_PAIR_STATS_BITS)
+#define BINDER_PAIR_STATS_PROBES 8
+#define BINDER_LATENCY_BUCKETS 16	/* i counts [2^(i-1), 2^i) usec */
+
+struct binder_pair_stats {
+	pid_t caller;
+	unsigned int code;
+	unsigned int count;		/* 0 if the slot is unused */
+	unsigned int oneway;
+	u64 bytes;
+	u64 pickup_us;
+	u64 reply_us;
+	unsigned int pickup_hist[BINDER_LATENCY_BUCKETS];
+	unsigned int reply_hist[BINDER_LATENCY_BUCKETS];
 };
 
 static void
@@ -517,6 +577,65 @@ static void binder_set_nice(long nice)
 	binder_user_error("binder: %d RLIMIT_NICE not set\n", current->pid);
 }
 
+static inline int binder_is_rt_policy(unsigned int policy)
+{
+	return policy == SCHED_FIFO || policy == SCHED_RR;
+}
+
+static struct binder_priority binder_get_priority(struct task_struct *task)
+{
+	struct binder_priority p;
+
+	p.sched_policy = task->policy;
+	if (binder_is_rt_policy(p.sched_policy))
+		p.prio = task->rt_priority;
+	else
+		p.prio = task_nice(task);
+	return p;
+}
+
+/*
+ * Returns nonzero if a runs ahead of b: any RT priority beats any nice
+ * value, a higher rt_priority beats a lower one, a lower nice beats a
+ * higher one.
+ */
+static int binder_priority_higher(struct binder_priority a,
+				  struct binder_priority b)
+{
+	if (binder_is_rt_policy(a.sched_policy) !=
+	    binder_is_rt_policy(b.sched_policy))
+		return binder_is_rt_policy(a.sched_policy);
+	if (binder_is_rt_policy(a.sched_policy))
+		return a.prio > b.prio;
+	return a.prio < b.prio;
+}
+
+/*
+ * Moves current to the scheduling class and priority in p.  Used to
+ * lend a synchronous caller's priority, RT included, to the thread
+ * serving it, and to give the thread its own priority back on reply.
+ * The caller already held that priority, so the RT limits are not
+ * checked again; nice values still go through binder_set_nice().
+ */
+static void binder_set_priority(struct binder_priority p)
+{
+	struct binder_priority cur = binder_get_priority(current);
+	struct sched_param param;
+
+	if (cur.sched_policy == p.sched_policy && cur.prio == p.prio)
+		return;
+	if (binder_is_rt_policy(p.sched_policy)) {
+		param.sched_priority = p.prio;
+		sched_setscheduler_nocheck(current, p.sched_policy, &param);
+		return;
+	}
+	if (current->policy != p.sched_policy) {
+		param.sched_priority = 0;
+		sched_setscheduler_nocheck(current, p.sched_policy, &param);
+	}
+	binder_set_nice(p.prio);
+}
+
 static size_t binder_buffer_size(struct binder_proc *proc,
 				 struct binder_buffer *buffer)
 {
@@ -626,6 +745,30 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 	if (end <= start)
 		return 0;
 
+	if (allocate) {
+		unsigned int mapped = 0;
+
+		if (vma == NULL && ACCESS_ONCE(proc->vma) == NULL) {
+			printk(KERN_ERR "binder: %d: binder_alloc_buf failed to "
+			       "map pages in userspace, no vma\n", proc->pid);
+			return -ENOMEM;
+		}
+		/* Pages still mapped here were kept by an earlier free */
+		for (page_addr = start; page_addr < end; page_addr += PAGE_SIZE)
+			if (proc->pages[(page_addr - proc->buffer) / PAGE_SIZE])
+				mapped++;
+		proc->cached_pages -= min(mapped, proc->cached_pages);
+		if (mapped == (end - start) / PAGE_SIZE)
+			return 0;
+	} else {
+		while (start < end && proc->cached_pages < binder_cached_pages) {
+			proc->cached_pages++;
+			start += PAGE_SIZE;
+		}
+		if (end <= start)
+			return 0;
+	}
+
 	if (vma)
 		mm = NULL;
 	else
@@ -650,7 +793,8 @@ static int binder_update_page_range(struct binder_proc *proc, int allocate,
 		struct page **page_array_ptr;
 		page = &proc->pages[(page_addr - proc->buffer) / PAGE_SIZE];
 
-		BUG_ON(*page);
+		if (*page)
+			continue;	/* cached, counted above */
 		*page = alloc_page(GFP_KERNEL | __GFP_ZERO);
 		if (*page == NULL) {
 			printk(KERN_ERR "binder: %d: binder_alloc_buf failed "
@@ -1230,6 +1374,98 @@ static int binder_dec_ref(struct binder_ref *ref, int strong)
 	return 0;
 }
 
+/*
+ * Finds the stats slot for (caller, code).  Only the queueing path, which
+ * counts the transaction, passes 'claim' to take a free slot; the others
+ * just look up the slot it took.  The table is allocated by the first
+ * claim made while pair stats are enabled.
+ */
+static struct binder_pair_stats *binder_get_pair_stats(struct binder_proc *proc,
+						       pid_t caller,
+						       unsigned int code,
+						       int claim)
+{
+	struct binder_pair_stats *ps;
+	unsigned int idx;
+	int i;
+
+	if (claim && !binder_pair_stats_enabled)
+		return NULL;
+	if (proc->pair_stats == NULL) {
+		if (!claim)
+			return NULL;
+		proc->pair_stats = kzalloc(sizeof(struct binder_pair_stats) *
+					   BINDER_PAIR_STATS_SIZE,
+					   GFP_KERNEL | __GFP_NOWARN);
+		if (proc->pair_stats == NULL)
+			return NULL;
+	}
+
+	idx = hash_32(caller ^ code, BINDER_PAIR_STATS_BITS);
+	for (i = 0; i < BINDER_PAIR_STATS_PROBES; i++) {
+		ps = &proc->pair_stats[(idx + i) & (BINDER_PAIR_STATS_SIZE - 1)];
+		if (ps->count == 0) {
+			if (!claim)
+				return NULL;
+			ps->caller = caller;
+			ps->code = code;
+			return ps;
+		}
+		if (ps->caller == caller && ps->code == code)
+			return ps;
+	}
+	if (claim)
+		proc->pair_stats_dropped++;
+	return NULL;
+}
+
+static void binder_latency_add(unsigned int *hist, u64 *total, ktime_t start)
+{
+	s64 us = ktime_us_delta(ktime_get(), start);
+
+	if (us < 0)
+		us = 0;
+	*total += us;
+	hist[min(fls64(us), BINDER_LATENCY_BUCKETS - 1)]++;
+}
+
+static void binder_stat_queued(struct binder_proc *target_proc,
+			       struct binder_transaction *t)
+{
+	struct binder_pair_stats *ps;
+
+	t->start = ktime_get();
+	ps = binder_get_pair_stats(target_proc, t->sender_pid, t->code, 1);
+	if (ps == NULL)
+		return;
+	ps->count++;
+	if (t->flags & TF_ONE_WAY)
+		ps->oneway++;
+	ps->bytes += t->buffer->data_size;
+}
+
+static void binder_stat_pickup(struct binder_proc *proc,
+			       struct binder_transaction *t)
+{
+	struct binder_pair_stats *ps;
+
+	ps = binder_get_pair_stats(proc, t->sender_pid, t->code, 0);
+	if (ps)
+		binder_latency_add(ps->pickup_hist, &ps->pickup_us, t->start);
+}
+
+static void binder_stat_reply(struct binder_proc *proc,
+			      struct binder_transaction *in_reply_to)
+{
+	struct binder_pair_stats *ps;
+
+	ps = binder_get_pair_stats(proc, in_reply_to->sender_pid,
+				   in_reply_to->code, 0);
+	if (ps)
+		binder_latency_add(ps->reply_hist, &ps->reply_us,
+				   in_reply_to->start);
+}
+
 static void binder_pop_transaction(struct binder_thread *target_thread,
 				   struct binder_transaction *t)
 {
@@ -1377,9 +1613,79 @@ static void binder_transaction_buffer_release(struct binder_proc *proc,
 	}
 }
 
+/*
+ * Wakes exactly one idle thread of proc for work queued on proc->todo.
+ * A thread that last ran on this cpu is preferred, since it can be
+ * woken without an IPI, then the thread that served the caller last
+ * time, then the thread that went idle most recently.  Falls back to
+ * proc->wait, for pollers, if no thread is idle.  A picked thread that
+ * returns without taking the work calls this again, so the work is not
+ * lost.  Must be called with binder_lock held.
+ */
+static void binder_wakeup_proc(struct binder_proc *proc,
+			       struct binder_thread *caller)
+{
+	struct binder_thread *thread;
+	struct binder_thread *target = NULL;
+	int cpu = raw_smp_processor_id();
+
+	list_for_each_entry(thread, &proc->waiting_threads, waiting_node) {
+		if (task_cpu(thread->task) == cpu) {
+			target = thread;
+			break;
+		}
+		if (target == NULL && thread->pid == caller->last_server)
+			target = thread;
+	}
+	/*
+	 * A thread that is already awake, from a signal or another wakeup,
+	 * may leave with other work; wake one that is really asleep.  It
+	 * comes off the list, so the next transaction picks another one.
+	 * Threads already awake stay listed until they relock.
+	 */
+	if (target && wake_up_process(target->task)) {
+		list_del_init(&target->waiting_node);
+		return;
+	}
+	list_for_each_entry(thread, &proc->waiting_threads, waiting_node) {
+		if (thread != target && wake_up_process(thread->task)) {
+			list_del_init(&thread->waiting_node);
+			return;
+		}
+	}
+	wake_up_interruptible(&proc->wait);
+}
+
+/*
+ * Gathers iov_count user segments into dst, which is size bytes long.
+ * The segments must fill dst exactly.
+ */
+static int binder_gather_from_user(void *dst, size_t size,
+				   const struct iovec __user *iov,
+				   size_t iov_count)
+{
+	struct iovec seg;
+
+	if (iov_count > UIO_MAXIOV)
+		return -EINVAL;
+	while (iov_count--) {
+		if (copy_from_user(&seg, iov++, sizeof(seg)))
+			return -EFAULT;
+		if (seg.iov_len > size)
+			return -EINVAL;
+		if (copy_from_user(dst, seg.iov_base, seg.iov_len))
+			return -EFAULT;
+		dst += seg.iov_len;
+		size -= seg.iov_len;
+	}
+	return size ? -EINVAL : 0;
+}
+
 static void binder_transaction(struct binder_proc *proc,
 			       struct binder_thread *thread,
-			       struct binder_transaction_data *tr, int reply)
+			       struct binder_transaction_data *tr, int reply,
+			       const struct iovec __user *iov,
+			       size_t iov_count)
 {
 	struct binder_transaction *t;
 	struct binder_work *tcomplete;
@@ -1410,7 +1716,7 @@ static void binder_transaction(struct binder_proc *proc,
 			return_error = BR_FAILED_REPLY;
 			goto err_empty_call_stack;
 		}
-		binder_set_nice(in_reply_to->saved_priority);
+		binder_set_priority(in_reply_to->saved_priority);
 		if (in_reply_to->to_thread != thread) {
 			binder_user_error("binder: %d:%d got reply transaction "
 				"with bad transaction stack,"
@@ -1540,11 +1846,12 @@ static void binder_transaction(struct binder_proc *proc,
 	else
 		t->from = NULL;
 	t->sender_euid = proc->tsk->cred->euid;
+	t->sender_pid = proc->pid;
 	t->to_proc = target_proc;
 	t->to_thread = target_thread;
 	t->code = tr->code;
 	t->flags = tr->flags;
-	t->priority = task_nice(current);
+	t->priority = binder_get_priority(current);
 	t->buffer = binder_alloc_buf(target_proc, tr->data_size,
 		tr->offsets_size, !reply && (t->flags & TF_ONE_WAY));
 	if (t->buffer == NULL) {
@@ -1560,7 +1867,15 @@ static void binder_transaction(struct binder_proc *proc,
 
 	offp = (size_t *)(t->buffer->data + ALIGN(tr->data_size, sizeof(void *)));
 
-	if (copy_from_user(t->buffer->data, tr->data.ptr.buffer, tr->data_size)) {
+	if (iov) {
+		if (binder_gather_from_user(t->buffer->data, tr->data_size,
+					    iov, iov_count)) {
+			binder_user_error("binder: %d:%d got transaction with "
+				"invalid data iovec\n", proc->pid, thread->pid);
+			return_error = BR_FAILED_REPLY;
+			goto err_copy_data_failed;
+		}
+	} else if (copy_from_user(t->buffer->data, tr->data.ptr.buffer, tr->data_size)) {
 		binder_user_error("binder: %d:%d got transaction with invalid "
 			"data ptr\n", proc->pid, thread->pid);
 		return_error = BR_FAILED_REPLY;
@@ -1719,6 +2034,7 @@ static void binder_transaction(struct binder_proc *proc,
 	}
 	if (reply) {
 		BUG_ON(t->buffer->async_transaction != 0);
+		binder_stat_reply(proc, in_reply_to);
 		binder_pop_transaction(target_thread, in_reply_to);
 		event_log_binder_produce_reply(t);
 	} else if (!(t->flags & TF_ONE_WAY)) {
@@ -1737,11 +2053,15 @@ static void binder_transaction(struct binder_proc *proc,
 			target_node->has_async_transaction = 1;
 		event_log_binder_produce_oneway(t);
 	}
+	if (!reply)
+		binder_stat_queued(target_proc, t);
 	t->work.type = BINDER_WORK_TRANSACTION;
 	list_add_tail(&t->work.entry, target_list);
 	tcomplete->type = BINDER_WORK_TRANSACTION_COMPLETE;
 	list_add_tail(&tcomplete->entry, &thread->todo);
-	if (target_wait)
+	if (target_wait == &target_proc->wait)
+		binder_wakeup_proc(target_proc, thread);
+	else if (target_wait)
 		wake_up_interruptible(target_wait);
 
 	return;
@@ -1981,7 +2301,20 @@ int binder_thread_write(struct binder_proc *proc, struct binder_thread *thread,
 			if (copy_from_user(&tr, ptr, sizeof(tr)))
 				return -EFAULT;
 			ptr += sizeof(tr);
-			binder_transaction(proc, thread, &tr, cmd == BC_REPLY);
+			binder_transaction(proc, thread, &tr, cmd == BC_REPLY,
+					   NULL, 0);
+			break;
+		}
+
+		case BC_TRANSACTION_SG:
+		case BC_REPLY_SG: {
+			struct binder_transaction_data_sg tr;
+
+			if (copy_from_user(&tr, ptr, sizeof(tr)))
+				return -EFAULT;
+			ptr += sizeof(tr);
+			binder_transaction(proc, thread, &tr.transaction_data,
+					   cmd == BC_REPLY_SG, tr.iov, tr.iov_count);
 			break;
 		}
 
@@ -2236,8 +2569,12 @@ retry:
 
 
 	thread->looper |= BINDER_LOOPER_STATE_WAITING;
-	if (wait_for_proc_work)
+	if (wait_for_proc_work) {
 		proc->ready_threads++;
+		/* Most recently idle first, its cache is the warmest */
+		if (!non_block)
+			list_add(&thread->waiting_node, &proc->waiting_threads);
+	}
 	mutex_unlock(&binder_lock);
 	if (wait_for_proc_work) {
 		if (!(thread->looper & (BINDER_LOOPER_STATE_REGISTERED |
@@ -2263,8 +2600,17 @@ retry:
 			ret = wait_event_interruptible(thread->wait, binder_has_thread_work(thread));
 	}
 	mutex_lock(&binder_lock);
-	if (wait_for_proc_work)
+	if (wait_for_proc_work) {
 		proc->ready_threads--;
+		if (!list_empty(&thread->waiting_node))
+			list_del_init(&thread->waiting_node);
+		else if (!non_block && ret && !list_empty(&proc->todo))
+			/*
+			 * binder_wakeup_proc() picked us, but a signal or
+			 * the freezer got here first; hand the work on.
+			 */
+			binder_wakeup_proc(proc, thread);
+	}
 	thread->looper &= ~BINDER_LOOPER_STATE_WAITING;
 
 	if (ret)
@@ -2412,13 +2758,22 @@ retry:
 			struct binder_node *target_node = t->buffer->target_node;
 			tr.target.ptr = target_node->ptr;
 			tr.cookie =  target_node->cookie;
-			t->saved_priority = task_nice(current);
-			if (t->priority < target_node->min_priority &&
-			    !(t->flags & TF_ONE_WAY))
-				binder_set_nice(t->priority);
-			else if (!(t->flags & TF_ONE_WAY) ||
-				 t->saved_priority > target_node->min_priority)
+			t->saved_priority = binder_get_priority(current);
+			if (!(t->flags & TF_ONE_WAY)) {
+				struct binder_priority p = t->priority;
+
+				if (!binder_is_rt_policy(p.sched_policy) &&
+				    p.prio > target_node->min_priority)
+					p.prio = target_node->min_priority;
+				/* Only ever raise; never drop an RT thread to CFS */
+				if (binder_priority_higher(p, t->saved_priority))
+					binder_set_priority(p);
+			} else if (!binder_is_rt_policy(t->saved_priority.sched_policy) &&
+				   t->saved_priority.prio > target_node->min_priority)
 				binder_set_nice(target_node->min_priority);
+			binder_stat_pickup(proc, t);
+			if (t->from)
+				t->from->last_server = thread->pid;
 			cmd = BR_TRANSACTION;
 		} else {
 			tr.target.ptr = NULL;
@@ -2546,8 +2901,10 @@ static struct binder_thread *binder_get_thread(struct binder_proc *proc)
 		binder_stats_created(BINDER_STAT_THREAD);
 		thread->proc = proc;
 		thread->pid = current->pid;
+		thread->task = current;
 		init_waitqueue_head(&thread->wait);
 		INIT_LIST_HEAD(&thread->todo);
+		INIT_LIST_HEAD(&thread->waiting_node);
 		rb_link_node(&thread->rb_node, parent, p);
 		rb_insert_color(&thread->rb_node, &proc->threads);
 		thread->looper |= BINDER_LOOPER_STATE_NEED_RETURN;
@@ -2890,6 +3247,7 @@ static int binder_open(struct inode *nodp, struct file *filp)
 	get_task_struct(current);
 	proc->tsk = current;
 	INIT_LIST_HEAD(&proc->todo);
+	INIT_LIST_HEAD(&proc->waiting_threads);
 	init_waitqueue_head(&proc->wait);
 	proc->default_priority = task_nice(current);
 	mutex_lock(&binder_lock);
@@ -3058,6 +3416,7 @@ static void binder_deferred_release(struct binder_proc *proc)
 		kfree(proc->pages);
 		vfree(proc->buffer);
 	}
+	kfree(proc->pair_stats);
 
 	put_task_struct(proc->tsk);
 
@@ -3129,13 +3488,14 @@ static void print_binder_transaction(struct seq_file *m, const char *prefix,
 				     struct binder_transaction *t)
 {
 	seq_printf(m,
-		   "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %ld r%d",
+		   "%s %d: %p from %d:%d to %d:%d code %x flags %x pri %u:%d r%d",
 		   prefix, t->debug_id, t,
 		   t->from ? t->from->proc->pid : 0,
 		   t->from ? t->from->pid : 0,
 		   t->to_proc ? t->to_proc->pid : 0,
 		   t->to_thread ? t->to_thread->pid : 0,
-		   t->code, t->flags, t->priority, t->need_reply);
+		   t->code, t->flags, t->priority.sched_policy,
+		   t->priority.prio, t->need_reply);
 	if (t->buffer == NULL) {
 		seq_puts(m, " buffer free\n");
 		return;
@@ -3337,7 +3697,9 @@ static const char *binder_command_strings[] = {
 	"BC_EXIT_LOOPER",
 	"BC_REQUEST_DEATH_NOTIFICATION",
 	"BC_CLEAR_DEATH_NOTIFICATION",
-	"BC_DEAD_BINDER_DONE"
+	"BC_DEAD_BINDER_DONE",
+	"BC_TRANSACTION_SG",
+	"BC_REPLY_SG"
 };
 
 static const char *binder_objstat_strings[] = {
@@ -3398,9 +3760,11 @@ static void print_binder_proc_stats(struct seq_file *m,
 	seq_printf(m, "  threads: %d\n", count);
 	seq_printf(m, "  requested threads: %d+%d/%d\n"
 			"  ready threads %d\n"
-			"  free async space %zd\n", proc->requested_threads,
+			"  free async space %zd\n"
+			"  cached pages %u\n", proc->requested_threads,
 			proc->requested_threads_started, proc->max_threads,
-			proc->ready_threads, proc->free_async_space);
+			proc->ready_threads, proc->free_async_space,
+			proc->cached_pages);
 	count = 0;
 	for (n = rb_first(&proc->nodes); n != NULL; n = rb_next(n))
 		count++;
@@ -3499,6 +3863,62 @@ static int binder_transactions_show(struct seq_file *m, void *unused)
 	return 0;
 }
 
+static void print_binder_latency_hist(struct seq_file *m, const char *prefix,
+				      unsigned int *hist)
+{
+	int i;
+
+	seq_puts(m, prefix);
+	for (i = 0; i < BINDER_LATENCY_BUCKETS; i++)
+		seq_printf(m, " %u", hist[i]);
+	seq_puts(m, "\n");
+}
+
+static void print_binder_pair_stats(struct seq_file *m,
+				    struct binder_proc *proc)
+{
+	struct binder_pair_stats *ps;
+	int i;
+
+	if (proc->pair_stats == NULL)
+		return;
+
+	seq_printf(m, "proc %d\n", proc->pid);
+	if (proc->pair_stats_dropped)
+		seq_printf(m, "  dropped %u\n", proc->pair_stats_dropped);
+	for (i = 0; i < BINDER_PAIR_STATS_SIZE; i++) {
+		ps = &proc->pair_stats[i];
+		if (ps->count == 0)
+			continue;
+		seq_printf(m, "  from %d code %u: count %u oneway %u bytes %llu "
+			   "pickup %llu us reply %llu us\n",
+			   ps->caller, ps->code, ps->count, ps->oneway,
+			   (unsigned long long)ps->bytes,
+			   (unsigned long long)ps->pickup_us,
+			   (unsigned long long)ps->reply_us);
+		print_binder_latency_hist(m, "    pickup", ps->pickup_hist);
+		print_binder_latency_hist(m, "    reply ", ps->reply_hist);
+	}
+}
+
+static int binder_pair_stats_show(struct seq_file *m, void *unused)
+{
+	struct binder_proc *proc;
+	struct hlist_node *pos;
+	int do_lock = !binder_debug_no_lock;
+
+	if (do_lock)
+		mutex_lock(&binder_lock);
+
+	seq_printf(m, "binder pair stats (latency buckets of 2^i us, %d):\n",
+		   BINDER_LATENCY_BUCKETS);
+	hlist_for_each_entry(proc, pos, &binder_procs, proc_node)
+		print_binder_pair_stats(m, proc);
+	if (do_lock)
+		mutex_unlock(&binder_lock);
+	return 0;
+}
+
 static int binder_proc_show(struct seq_file *m, void *unused)
 {
 	struct binder_proc *proc = m->private;
@@ -3557,6 +3977,7 @@ static struct miscdevice binder_miscdev = {
 BINDER_DEBUG_ENTRY(state);
 BINDER_DEBUG_ENTRY(stats);
 BINDER_DEBUG_ENTRY(transactions);
+BINDER_DEBUG_ENTRY(pair_stats);
 BINDER_DEBUG_ENTRY(transaction_log);
 
 static int __init binder_init(void)
@@ -3588,6 +4009,11 @@ static int __init binder_init(void)
 				    binder_debugfs_dir_entry_root,
 				    NULL,
 				    &binder_transactions_fops);
+		debugfs_create_file("pair_stats",
+				    S_IRUGO,
+				    binder_debugfs_dir_entry_root,
+				    NULL,
+				    &binder_pair_stats_fops);
 		debugfs_create_file("transaction_log",
 				    S_IRUGO,
 				    binder_debugfs_dir_entry_root,
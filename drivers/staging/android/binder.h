@@ -21,6 +21,7 @@
 #define _LINUX_BINDER_H
 
 #include <linux/ioctl.h>
+#include <linux/uio.h>
 
 #define B_PACK_CHARS(c1, c2, c3, c4) \
 	((((c1)<<24)) | (((c2)<<16)) | (((c3)<<8)) | (c4))
@@ -147,6 +148,19 @@ struct binder_transaction_data {
 	} data;
 };
 
+/*
+ * Sent with BC_TRANSACTION_SG and BC_REPLY_SG.  The data is gathered
+ * from iov straight into the target's buffer, so a sender does not have
+ * to flatten a large parcel first; transaction_data.data.ptr.buffer is
+ * ignored and data_size must equal the total length of iov.  Offsets
+ * are relative to the start of the gathered data.
+ */
+struct binder_transaction_data_sg {
+	struct binder_transaction_data	transaction_data;
+	const struct iovec	*iov;
+	size_t		iov_count;
+};
+
 struct binder_ptr_cookie {
 	void *ptr;
 	void *cookie;
@@ -324,6 +338,13 @@ enum BinderDriverCommandProtocol {
 	/*
 	 * void *: cookie
 	 */
+
+	BC_TRANSACTION_SG = _IOW('c', 17, struct binder_transaction_data_sg),
+	BC_REPLY_SG = _IOW('c', 18, struct binder_transaction_data_sg),
+	/*
+	 * binder_transaction_data_sg: the sent command, with its data
+	 * scattered over an iovec.
+	 */
 };
 
 #endif /* _LINUX_BINDER_H */
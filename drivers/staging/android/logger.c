@@ -21,49 +21,144 @@
 #include <linux/module.h>
 #include <linux/fs.h>
 #include <linux/miscdevice.h>
+#include <linux/mm.h>
 #include <linux/uaccess.h>
 #include <linux/poll.h>
 #include <linux/slab.h>
 #include <linux/time.h>
+#include <linux/atomic.h>
+#include <linux/log2.h>
+#include <linux/random.h>
+#include <linux/lzo.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
 #include "logger.h"
 
 #include <asm/ioctls.h>
 
+/*
+ * Writers do not serialize against each other or against readers.
+ *
+ * Positions in a log are 64-bit byte counts that only ever grow; the offset
+ * into the ring is the position modulo the log size.  A writer claims space
+ * for its record by adding the record's size to 'w_off', copies the record
+ * in, and commits it by storing the record's position in its first word.
+ * Before copying, it moves 'head', the position of the oldest record, past
+ * every record it is about to overwrite.
+ *
+ * Readers keep their own position.  A record is readable once its commit
+ * word matches its position, and a reader's copy of it is valid if 'head'
+ * has not passed it by the time the copy is done.  A reader that was lapped
+ * simply restarts at 'head'.
+ *
+ * With CONFIG_ANDROID_LOGGER_COMPRESS, a worker also compresses the ring,
+ * a chunk at a time, into the log's archive before the writers lap it.  The
+ * chunks keep their positions, so a reader behind 'head' reads on from the
+ * archive and then from the ring without noticing the switch.
+ */
+
+#define LOGGER_MIN_SIZE		(64*1024)	/* smallest ring or archive */
+
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+
+#define LOGGER_CHUNK_SIZE	(16*1024)	/* bytes of records per chunk */
+
+/*
+ * struct logger_chunk - describes a compressed run of records in an archive
+ */
+struct logger_chunk {
+	u64			start;	/* position of its first record */
+	u64			end;	/* position just past its last record */
+	size_t			off;	/* offset of its data in the archive */
+	size_t			len;	/* length of its compressed data */
+};
+
+/*
+ * struct logger_archive - the compressed older entries of a log
+ *
+ * 'chunks' is a ring of chunk descriptors, oldest first, whose data is laid
+ * out in the same order in 'data', wrapping to the start of 'data' when a
+ * chunk does not fit before its end. The oldest chunks are dropped to make
+ * room. 'mutex' protects both rings; only 'work' writes to them.
+ */
+struct logger_archive {
+	struct mutex		mutex;	/* protects chunks and data */
+	struct work_struct	work;	/* compresses the ring into chunks */
+	atomic64_t		archived; /* records before here are archived */
+	struct logger_chunk	*chunks; /* ring of chunk descriptors */
+	unsigned int		nr_chunks; /* capacity of 'chunks' */
+	unsigned int		first;	/* index of the oldest chunk */
+	unsigned int		count;	/* chunks in the archive */
+	unsigned char		*data;	/* compressed chunk data */
+	size_t			size;	/* size of 'data', 0 if disabled */
+	size_t			w_off;	/* where the next chunk's data goes */
+	unsigned char		*raw;	/* chunk being compressed */
+	unsigned char		*out;	/* its compressed form */
+	void			*wrkmem; /* lzo work memory */
+};
+
+#endif /* CONFIG_ANDROID_LOGGER_COMPRESS */
+
 /*
  * struct logger_log - represents a specific log, such as 'main' or 'radio'
  *
  * This structure lives from module insertion until module removal, so it does
- * not need additional reference counting. The structure is protected by the
- * mutex 'mutex'.
+ * not need additional reference counting. The mutex 'mutex' protects the list
+ * of readers and 'flushed'; the ring itself is lock-free.
  */
 struct logger_log {
 	unsigned char 		*buffer;/* the ring buffer itself */
 	struct miscdevice	misc;	/* misc device representing the log */
 	wait_queue_head_t	wq;	/* wait queue for readers */
+	wait_queue_head_t	commit_wq; /* writers waiting for the head */
 	struct list_head	readers; /* this log's readers */
-	struct mutex		mutex;	/* mutex protecting buffer */
-	size_t			w_off;	/* current write head offset */
-	size_t			head;	/* new readers start here */
+	struct mutex		mutex;	/* mutex protecting readers, flushed */
+	atomic64_t		w_off;	/* end of the last claimed record */
+	atomic64_t		head;	/* oldest record still in the ring */
+	u64			flushed; /* new readers start no earlier */
+	u64			key;	/* per-boot secret in commit words */
 	size_t			size;	/* size of the log */
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	struct logger_archive	archive; /* compressed older entries */
+#endif
 };
 
+#define LOGGER_RECORD_MAX	ALIGN(sizeof(struct logger_record) + \
+				      LOGGER_ENTRY_MAX_PAYLOAD, 8)
+
 /*
  * struct logger_reader - a logging device open for reading
  *
  * This object lives from open to release, so we don't need additional
- * reference counting. The structure is protected by log->mutex.
+ * reference counting. The structure is protected by reader->mutex.
  */
 struct logger_reader {
 	struct logger_log	*log;	/* associated log */
 	struct list_head	list;	/* entry in logger_log's list */
-	size_t			r_off;	/* current read head offset */
+	struct mutex		mutex;	/* serializes reads of this reader */
+	u64			r_off;	/* position of the next record */
 	bool			r_all;	/* reader can read all entries */
 	int			r_ver;	/* reader ABI version */
+	bool			r_have;	/* 'rec' and 'msg' hold the next record */
+	bool			r_batch; /* read() returns as many as fit */
+	struct logger_record	rec;	/* copy of the next record's header */
+	unsigned char		msg[LOGGER_ENTRY_MAX_PAYLOAD]; /* its payload */
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	unsigned char		*zbuf;	/* last archived chunk read, or NULL */
+	u64			z_start; /* position of zbuf's first record */
+	u64			z_end;	/* position just past its last record */
+#endif
 };
 
 /* logger_offset - returns index 'n' into the log via (optimized) modulus */
 #define logger_offset(n)	((n) & (log->size - 1))
 
+/* pos_before - is position 'a' older than position 'b'? */
+static inline int pos_before(u64 a, u64 b)
+{
+	return (s64) (a - b) < 0;
+}
+
 /*
  * file_get_log - Given a file structure, return the associated log
  *
@@ -88,326 +183,564 @@ static inline struct logger_log *file_get_log(struct file *file)
 }
 
 /*
- * get_entry_header - returns a pointer to the logger_entry header within
- * 'log' starting at offset 'off'. A temporary logger_entry 'scratch' must
- * be provided. Typically the return value will be a pointer within
- * 'logger->buf'.  However, a pointer to 'scratch' may be returned if
- * the log entry spans the end and beginning of the circular buffer.
+ * ring_read - copies 'len' bytes at position 'pos' of 'log' to 'dst',
+ * wrapping around the end of the ring.
  */
-static struct logger_entry *get_entry_header(struct logger_log *log,
-		size_t off, struct logger_entry *scratch)
+static void ring_read(struct logger_log *log, u64 pos, void *dst, size_t len)
 {
-	size_t len = min(sizeof(struct logger_entry), log->size - off);
-	if (len != sizeof(struct logger_entry)) {
-		memcpy(((void *) scratch), log->buffer + off, len);
-		memcpy(((void *) scratch) + len, log->buffer,
-			sizeof(struct logger_entry) - len);
-		return scratch;
-	}
+	size_t off = logger_offset(pos);
+	size_t first = min(len, log->size - off);
 
-	return (struct logger_entry *) (log->buffer + off);
+	memcpy(dst, log->buffer + off, first);
+	if (len != first)
+		memcpy(dst + first, log->buffer, len - first);
 }
 
 /*
- * get_entry_msg_len - Grabs the length of the message of the entry
- * starting from from 'off'.
- *
- * Caller needs to hold log->mutex.
+ * ring_write - copies 'len' bytes from 'src' to position 'pos' of 'log'.
  */
-static __u32 get_entry_msg_len(struct logger_log *log, size_t off)
+static void ring_write(struct logger_log *log, u64 pos, const void *src,
+		       size_t len)
 {
-	struct logger_entry scratch;
-	struct logger_entry *entry;
+	size_t off = logger_offset(pos);
+	size_t first = min(len, log->size - off);
 
-	entry = get_entry_header(log, off, &scratch);
-	return entry->len;
+	memcpy(log->buffer + off, src, first);
+	if (len != first)
+		memcpy(log->buffer, src + first, len - first);
 }
 
-static size_t get_user_hdr_len(int ver)
+/*
+ * ring_write_from_user - copies 'len' bytes from the user-space buffer 'src'
+ * to position 'pos' of 'log'. Returns 0 on success, -EFAULT on failure.
+ */
+static int ring_write_from_user(struct logger_log *log, u64 pos,
+				const void __user *src, size_t len)
 {
-	if (ver < 2)
-		return sizeof(struct user_logger_entry_compat);
-	else
-		return sizeof(struct logger_entry);
+	size_t off = logger_offset(pos);
+	size_t first = min(len, log->size - off);
+
+	if (first && copy_from_user(log->buffer + off, src, first))
+		return -EFAULT;
+	if (len != first && copy_from_user(log->buffer, src + first, len - first))
+		return -EFAULT;
+	return 0;
 }
 
-static ssize_t copy_header_to_user(int ver, struct logger_entry *entry,
-					 char __user *buf)
+/* ring_commit - returns the commit word of the record at 'pos' */
+static inline u64 ring_commit(struct logger_log *log, u64 pos)
 {
-	void *hdr;
-	size_t hdr_len;
-	struct user_logger_entry_compat v1;
-
-	if (ver < 2) {
-		v1.len      = entry->len;
-		v1.__pad    = 0;
-		v1.pid      = entry->pid;
-		v1.tid      = entry->tid;
-		v1.sec      = entry->sec;
-		v1.nsec     = entry->nsec;
-		hdr         = &v1;
-		hdr_len     = sizeof(struct user_logger_entry_compat);
-	} else {
-		hdr         = entry;
-		hdr_len     = sizeof(struct logger_entry);
-	}
-
-	return copy_to_user(buf, hdr, hdr_len);
+	return ACCESS_ONCE(*(u64 *) (log->buffer + logger_offset(pos)));
 }
 
 /*
- * do_read_log_to_user - reads exactly 'count' bytes from 'log' into the
- * user-space buffer 'buf'. Returns 'count' on success.
+ * commit_word - the commit word of a written record at 'pos'
  *
- * Caller must hold log->mutex.
+ * Positions are no secret, and a payload from an earlier lap may sit where
+ * a later record starts, so the position alone would let a writer forge a
+ * commit. Mixing in the log's key, which only 'r_all' readers are told,
+ * means user data can't match it.
  */
-static ssize_t do_read_log_to_user(struct logger_log *log,
-				   struct logger_reader *reader,
-				   char __user *buf,
-				   size_t count)
+static inline u64 commit_word(struct logger_log *log, u64 pos)
 {
-	struct logger_entry scratch;
-	struct logger_entry *entry;
-	size_t len;
-	size_t msg_start;
+	return pos ^ log->key;
+}
 
-	/*
-	 * First, copy the header to userspace, using the version of
-	 * the header requested
-	 */
-	entry = get_entry_header(log, reader->r_off, &scratch);
-	if (copy_header_to_user(reader->r_ver, entry, buf))
-		return -EFAULT;
+/* ring_committed - returns whether the record at 'pos' has been written */
+static inline int ring_committed(struct logger_log *log, u64 pos)
+{
+	return ring_commit(log, pos) == commit_word(log, pos);
+}
 
-	count -= get_user_hdr_len(reader->r_ver);
-	buf += get_user_hdr_len(reader->r_ver);
-	msg_start = logger_offset(reader->r_off + sizeof(struct logger_entry));
+/*
+ * make_room - moves the log's head forward until the record ending at 'end'
+ * fits, so no reader trusts a record that is about to be overwritten.
+ *
+ * The head is only ever moved with a cmpxchg from the position it was read
+ * at, and no writer touches the record at the head until it has moved past
+ * it, so the size read from that record is good whenever the cmpxchg
+ * succeeds.
+ *
+ * If the oldest record is still being written, its writer may have been
+ * preempted by this one, so sleep until it commits rather than spin.
+ */
+static void make_room(struct logger_log *log, u64 end)
+{
+	struct logger_record rec;
+	u64 head;
 
-	/*
-	 * We read from the msg in two disjoint operations. First, we read from
-	 * the current msg head offset up to 'count' bytes or to the end of
-	 * the log, whichever comes first.
-	 */
-	len = min(count, log->size - msg_start);
-	if (copy_to_user(buf, log->buffer + msg_start, len))
-		return -EFAULT;
+	for (;;) {
+		head = atomic64_read(&log->head);
+		if (end - head <= log->size)
+			break;
+		if (!ring_committed(log, head)) {
+			wait_event(log->commit_wq,
+				   ring_committed(log, head) ||
+				   atomic64_read(&log->head) != head);
+			continue;
+		}
+		smp_rmb();
+		ring_read(log, head, &rec, sizeof(rec));
+		atomic64_cmpxchg(&log->head, head, head + rec.size);
+	}
+}
 
-	/*
-	 * Second, we read any remaining bytes, starting back at the head of
-	 * the log.
-	 */
-	if (count != len)
-		if (copy_to_user(buf + len, log->buffer, count - len))
-			return -EFAULT;
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
 
-	reader->r_off = logger_offset(reader->r_off +
-		sizeof(struct logger_entry) + count);
+/* archive_drop_oldest - drops the oldest chunk of 'ar' */
+static inline void archive_drop_oldest(struct logger_archive *ar)
+{
+	ar->first = (ar->first + 1) % ar->nr_chunks;
+	ar->count--;
+}
 
-	return count + get_user_hdr_len(reader->r_ver);
+/* chunk_overlaps - does the data of 'c' overlap 'len' bytes at 'off'? */
+static inline int chunk_overlaps(struct logger_chunk *c, size_t off, size_t len)
+{
+	return c->off < off + len && off < c->off + c->len;
 }
 
 /*
- * get_next_entry_by_uid - Starting at 'off', returns an offset into
- * 'log->buffer' which contains the first entry readable by 'euid'
+ * archive_add - adds the chunk of 'len' compressed bytes in 'ar->out', which
+ * holds the records from 'start' to 'end', dropping old chunks to make room.
+ *
+ * Caller must hold ar->mutex.
  */
-static size_t get_next_entry_by_uid(struct logger_log *log,
-		size_t off, uid_t euid)
+static void archive_add(struct logger_archive *ar, u64 start, u64 end,
+			size_t len)
 {
-	while (off != log->w_off) {
-		struct logger_entry *entry;
-		struct logger_entry scratch;
-		size_t next_len;
+	struct logger_chunk *c;
+	size_t off = ar->w_off;
+
+	if (off + len > ar->size) {
+		/* no room before the end; drop the chunks there and wrap */
+		while (ar->count && ar->chunks[ar->first].off >= off)
+			archive_drop_oldest(ar);
+		off = 0;
+	}
+	while (ar->count && (ar->count == ar->nr_chunks ||
+			     chunk_overlaps(&ar->chunks[ar->first], off, len)))
+		archive_drop_oldest(ar);
+
+	c = &ar->chunks[(ar->first + ar->count) % ar->nr_chunks];
+	c->start = start;
+	c->end = end;
+	c->off = off;
+	c->len = len;
+	memcpy(ar->data + off, ar->out, len);
+	ar->count++;
+	ar->w_off = off + len;
+}
 
-		entry = get_entry_header(log, off, &scratch);
+/*
+ * archive_work - compresses every full chunk of written records that is not
+ * archived yet. Records the writers lap before this runs are lost, as they
+ * would be without an archive.
+ */
+static void archive_work(struct work_struct *work)
+{
+	struct logger_log *log = container_of(work, struct logger_log,
+					      archive.work);
+	struct logger_archive *ar = &log->archive;
+	struct logger_record rec;
+	size_t len;
+	u64 start, end;
+	int ret;
 
-		if (entry->euid == euid)
-			return off;
+	for (;;) {
+		start = atomic64_read(&ar->archived);
+		if (pos_before(start, atomic64_read(&log->head)))
+			start = atomic64_read(&log->head);
+
+		/* find the whole records that fill a chunk */
+		end = start;
+		for (;;) {
+			if (end == atomic64_read(&log->w_off) ||
+			    !ring_committed(log, end))
+				goto out;
+			smp_rmb();
+			ring_read(log, end, &rec, sizeof(rec));
+			if (rec.size < sizeof(rec) || rec.size > LOGGER_RECORD_MAX)
+				goto out;	/* lapped; start over next time */
+			if (end + rec.size - start > LOGGER_CHUNK_SIZE)
+				break;
+			end += rec.size;
+		}
 
-		next_len = sizeof(struct logger_entry) + entry->len;
-		off = logger_offset(off + next_len);
+		ring_read(log, start, ar->raw, end - start);
+		smp_rmb();
+		if (pos_before(start, atomic64_read(&log->head)))
+			continue;
+
+		ret = lzo1x_1_compress(ar->raw, end - start, ar->out, &len,
+				       ar->wrkmem);
+		if (ret == LZO_E_OK) {
+			mutex_lock(&ar->mutex);
+			archive_add(ar, start, end, len);
+			mutex_unlock(&ar->mutex);
+		} else
+			printk(KERN_ERR "logger: failed to compress log '%s': "
+			       "%d\n", log->misc.name, ret);
+		atomic64_set(&ar->archived, end);
 	}
 
-	return off;
+out:
+	atomic64_set(&ar->archived, start);
 }
 
 /*
- * logger_read - our log's read() method
- *
- * Behavior:
- *
- * 	- O_NONBLOCK works
- * 	- If there are no log entries to read, blocks until log is written to
- * 	- Atomically reads exactly one log entry
- *
- * Will set errno to EINVAL if read
- * buffer is insufficient to hold next entry.
+ * archive_kick - schedules compression once a full chunk past the archived
+ * records has been written.
  */
-static ssize_t logger_read(struct file *file, char __user *buf,
-			   size_t count, loff_t *pos)
+static inline void archive_kick(struct logger_log *log, u64 end)
 {
-	struct logger_reader *reader = file->private_data;
-	struct logger_log *log = reader->log;
-	ssize_t ret;
-	DEFINE_WAIT(wait);
+	struct logger_archive *ar = &log->archive;
 
-start:
-	while (1) {
-		prepare_to_wait(&log->wq, &wait, TASK_INTERRUPTIBLE);
+	if (ar->size && end - atomic64_read(&ar->archived) >= LOGGER_CHUNK_SIZE)
+		queue_work(system_nrt_wq, &ar->work);
+}
 
-		mutex_lock(&log->mutex);
-		ret = (log->w_off == reader->r_off);
-		mutex_unlock(&log->mutex);
-		if (!ret)
-			break;
+/*
+ * load_chunk - decompresses the oldest chunk that ends after the reader's
+ * position into the reader's 'zbuf', moving the reader to the chunk's first
+ * record if it was older still. Returns 1 on success, 0 if there is no such
+ * chunk.
+ *
+ * Caller must hold reader->mutex.
+ */
+static int load_chunk(struct logger_log *log, struct logger_reader *reader)
+{
+	struct logger_archive *ar = &log->archive;
+	struct logger_chunk *c = NULL;
+	unsigned int i;
+	size_t len;
+	int ret = 0;
 
-		if (file->f_flags & O_NONBLOCK) {
-			ret = -EAGAIN;
-			break;
-		}
+	reader->z_end = reader->z_start;
 
-		if (signal_pending(current)) {
-			ret = -EINTR;
+	mutex_lock(&ar->mutex);
+	for (i = 0; i < ar->count; i++) {
+		c = &ar->chunks[(ar->first + i) % ar->nr_chunks];
+		if (pos_before(reader->r_off, c->end))
 			break;
-		}
-
-		schedule();
 	}
+	if (i == ar->count)
+		goto out;
 
-	finish_wait(&log->wq, &wait);
-	if (ret)
-		return ret;
+	len = LOGGER_CHUNK_SIZE;
+	ret = lzo1x_decompress_safe(ar->data + c->off, c->len, reader->zbuf,
+				    &len);
+	if (ret != LZO_E_OK || len != c->end - c->start) {
+		printk(KERN_ERR "logger: corrupt chunk in log '%s': %d\n",
+		       log->misc.name, ret);
+		ret = 0;
+		goto out;
+	}
+	reader->z_start = c->start;
+	reader->z_end = c->end;
+	if (pos_before(reader->r_off, c->start))
+		reader->r_off = c->start;
+	ret = 1;
+out:
+	mutex_unlock(&ar->mutex);
+	return ret;
+}
 
-	mutex_lock(&log->mutex);
+/*
+ * fetch_archived - copies the record at the reader's position, which the
+ * writers have lapped, from the archive into 'rec' and 'msg'. Returns 1 if
+ * a record was copied, or 0 if the archive has nothing at or after it.
+ *
+ * Caller must hold reader->mutex.
+ */
+static int fetch_archived(struct logger_log *log, struct logger_reader *reader)
+{
+	struct logger_record *rec = &reader->rec;
+	size_t off, span;
 
-	if (!reader->r_all)
-		reader->r_off = get_next_entry_by_uid(log,
-			reader->r_off, current_euid());
+	if (!log->archive.size)
+		return 0;
+	if (pos_before(reader->r_off, reader->z_start) ||
+	    !pos_before(reader->r_off, reader->z_end))
+		if (!load_chunk(log, reader))
+			return 0;
+
+	/* a cursor set off a record boundary can point anywhere in zbuf */
+	off = reader->r_off - reader->z_start;
+	span = reader->z_end - reader->z_start;
+	if (off + sizeof(*rec) > span)
+		return 0;
+	memcpy(rec, reader->zbuf + off, sizeof(*rec));
+	if (rec->commit != commit_word(log, reader->r_off) ||
+	    rec->size < sizeof(*rec) || rec->size > LOGGER_RECORD_MAX ||
+	    rec->entry.len > LOGGER_ENTRY_MAX_PAYLOAD ||
+	    off + sizeof(*rec) + rec->entry.len > span)
+		return 0;
+	memcpy(reader->msg, reader->zbuf + off + sizeof(*rec), rec->entry.len);
+	return 1;
+}
 
-	/* is there still something to read or did we race? */
-	if (unlikely(log->w_off == reader->r_off)) {
-		mutex_unlock(&log->mutex);
-		goto start;
-	}
+/*
+ * archive_init - allocates the archive of 'log', if it has one. The log
+ * still works, without an archive, if that fails.
+ */
+static void __init archive_init(struct logger_log *log)
+{
+	struct logger_archive *ar = &log->archive;
+
+	mutex_init(&ar->mutex);
+	INIT_WORK(&ar->work, archive_work);
+	atomic64_set(&ar->archived, log->size);
+	if (!ar->size)
+		return;
+
+	ar->size = max_t(size_t, ar->size, LOGGER_MIN_SIZE);
+	ar->nr_chunks = ar->size / 512;
+	ar->chunks = vmalloc(ar->nr_chunks * sizeof(struct logger_chunk));
+	ar->data = vmalloc(ar->size);
+	ar->raw = vmalloc(LOGGER_CHUNK_SIZE);
+	ar->out = vmalloc(lzo1x_worst_compress(LOGGER_CHUNK_SIZE));
+	ar->wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (ar->chunks && ar->data && ar->raw && ar->out && ar->wrkmem)
+		return;
+
+	printk(KERN_ERR "logger: no memory to compress log '%s'\n",
+	       log->misc.name);
+	vfree(ar->chunks);
+	vfree(ar->data);
+	vfree(ar->raw);
+	vfree(ar->out);
+	vfree(ar->wrkmem);
+	ar->size = 0;
+}
 
-	/* get the size of the next entry */
-	ret = get_user_hdr_len(reader->r_ver) +
-		get_entry_msg_len(log, reader->r_off);
-	if (count < ret) {
-		ret = -EINVAL;
-		goto out;
-	}
+#else
 
-	/* get exactly one entry from the log */
-	ret = do_read_log_to_user(log, reader, buf, ret);
+static inline void archive_kick(struct logger_log *log, u64 end)
+{
+}
 
-out:
-	mutex_unlock(&log->mutex);
+static inline int fetch_archived(struct logger_log *log,
+				 struct logger_reader *reader)
+{
+	return 0;
+}
 
-	return ret;
+static inline void archive_init(struct logger_log *log)
+{
 }
 
+#endif /* CONFIG_ANDROID_LOGGER_COMPRESS */
+
 /*
- * get_next_entry - return the offset of the first valid entry at least 'len'
- * bytes after 'off'.
+ * fetch_record - copies the record at the reader's position into 'rec' and
+ * 'msg'. Returns 1 if a record was copied, or 0 if the reader has caught up
+ * with the writers. A reader that was lapped reads on from the archive, or
+ * is moved to the oldest record still in the ring.
  *
- * Caller must hold log->mutex.
+ * Caller must hold reader->mutex.
  */
-static size_t get_next_entry(struct logger_log *log, size_t off, size_t len)
+static int fetch_record(struct logger_log *log, struct logger_reader *reader)
 {
-	size_t count = 0;
-
-	do {
-		size_t nr = sizeof(struct logger_entry) +
-			get_entry_msg_len(log, off);
-		off = logger_offset(off + nr);
-		count += nr;
-	} while (count < len);
-
-	return off;
+	struct logger_record *rec = &reader->rec;
+
+	for (;;) {
+		if (pos_before(reader->r_off, atomic64_read(&log->head))) {
+			if (fetch_archived(log, reader))
+				return 1;
+			if (pos_before(reader->r_off, atomic64_read(&log->head)))
+				reader->r_off = atomic64_read(&log->head);
+		}
+		if (reader->r_off == atomic64_read(&log->w_off))
+			return 0;
+
+		if (!ring_committed(log, reader->r_off)) {
+			/* not written yet, unless a writer lapped us meanwhile */
+			smp_rmb();
+			if (pos_before(reader->r_off, atomic64_read(&log->head)))
+				continue;
+			return 0;
+		}
+		smp_rmb();
+		ring_read(log, reader->r_off, rec, sizeof(*rec));
+		ring_read(log, reader->r_off + sizeof(*rec), reader->msg,
+			  min_t(size_t, rec->entry.len, LOGGER_ENTRY_MAX_PAYLOAD));
+		smp_rmb();
+
+		/* the copy is good unless the head passed it meanwhile */
+		if (pos_before(reader->r_off, atomic64_read(&log->head)))
+			continue;
+
+		/* a cursor set off a record boundary; resync at the head */
+		if (unlikely(rec->size < sizeof(*rec) ||
+			     rec->size > LOGGER_RECORD_MAX ||
+			     rec->entry.len > LOGGER_ENTRY_MAX_PAYLOAD)) {
+			reader->r_off = atomic64_read(&log->head);
+			continue;
+		}
+		return 1;
+	}
 }
 
 /*
- * clock_interval - is a < c < b in mod-space? Put another way, does the line
- * from a to b cross c?
+ * next_record - makes 'rec' and 'msg' hold the next record this reader may
+ * see, skipping discarded records and, unless 'r_all' is set, other users'
+ * entries. Returns 1 if there is such a record, 0 if not.
+ *
+ * Caller must hold reader->mutex.
  */
-static inline int clock_interval(size_t a, size_t b, size_t c)
+static int next_record(struct logger_log *log, struct logger_reader *reader)
 {
-	if (b < a) {
-		if (a < c || b >= c)
-			return 1;
-	} else {
-		if (a < c && b >= c)
-			return 1;
+	while (!reader->r_have) {
+		if (!fetch_record(log, reader))
+			return 0;
+		if (!(reader->rec.flags & LOGGER_RECORD_DISCARD) &&
+		    (reader->r_all || reader->rec.entry.euid == current_euid()))
+			reader->r_have = true;
+		else
+			reader->r_off += reader->rec.size;
 	}
+	return 1;
+}
 
-	return 0;
+/* consume_record - moves the reader past the record held in 'rec' */
+static inline void consume_record(struct logger_reader *reader)
+{
+	reader->r_off += reader->rec.size;
+	reader->r_have = false;
 }
 
 /*
- * fix_up_readers - walk the list of all readers and "fix up" any who were
- * lapped by the writer; also do the same for the default "start head".
- * We do this by "pulling forward" the readers and start head to the first
- * entry after the new write head.
- *
- * The caller needs to hold log->mutex.
+ * log_readable - is there a written record at 'off' or did a writer lap it?
+ * Used as the readers' wait condition; next_record() makes the real check.
  */
-static void fix_up_readers(struct logger_log *log, size_t len)
+static int log_readable(struct logger_log *log, u64 off)
 {
-	size_t old = log->w_off;
-	size_t new = logger_offset(old + len);
-	struct logger_reader *reader;
+	if (off == atomic64_read(&log->w_off))
+		return 0;
+	return ring_committed(log, off) ||
+		pos_before(off, atomic64_read(&log->head));
+}
+
+static size_t get_user_hdr_len(int ver)
+{
+	if (ver < 2)
+		return sizeof(struct user_logger_entry_compat);
+	else
+		return sizeof(struct logger_entry);
+}
+
+static ssize_t copy_header_to_user(int ver, struct logger_entry *entry,
+					 char __user *buf)
+{
+	void *hdr;
+	size_t hdr_len;
+	struct user_logger_entry_compat v1;
 
-	if (clock_interval(old, new, log->head))
-		log->head = get_next_entry(log, log->head, len);
+	if (ver < 2) {
+		v1.len      = entry->len;
+		v1.__pad    = 0;
+		v1.pid      = entry->pid;
+		v1.tid      = entry->tid;
+		v1.sec      = entry->sec;
+		v1.nsec     = entry->nsec;
+		hdr         = &v1;
+		hdr_len     = sizeof(struct user_logger_entry_compat);
+	} else {
+		hdr         = entry;
+		hdr_len     = sizeof(struct logger_entry);
+	}
 
-	list_for_each_entry(reader, &log->readers, list)
-		if (clock_interval(old, new, reader->r_off))
-			reader->r_off = get_next_entry(log, reader->r_off, len);
+	return copy_to_user(buf, hdr, hdr_len);
 }
 
 /*
- * do_write_log - writes 'len' bytes from 'buf' to 'log'
+ * do_read_log_to_user - copies the record held by 'reader' into the
+ * user-space buffer 'buf', which has room for it. Returns the number of
+ * bytes copied on success.
  *
- * The caller needs to hold log->mutex.
+ * Caller must hold reader->mutex.
  */
-static void do_write_log(struct logger_log *log, const void *buf, size_t count)
+static ssize_t do_read_log_to_user(struct logger_reader *reader,
+				   char __user *buf)
 {
-	size_t len;
+	struct logger_entry *entry = &reader->rec.entry;
+	size_t hdr_len = get_user_hdr_len(reader->r_ver);
 
-	len = min(count, log->size - log->w_off);
-	memcpy(log->buffer + log->w_off, buf, len);
-
-	if (count != len)
-		memcpy(log->buffer, buf + len, count - len);
+	if (copy_header_to_user(reader->r_ver, entry, buf))
+		return -EFAULT;
+	if (copy_to_user(buf + hdr_len, reader->msg, entry->len))
+		return -EFAULT;
 
-	log->w_off = logger_offset(log->w_off + count);
+	consume_record(reader);
 
+	return hdr_len + entry->len;
 }
 
 /*
- * do_write_log_user - writes 'len' bytes from the user-space buffer 'buf' to
- * the log 'log'
+ * logger_read - our log's read() method
  *
- * The caller needs to hold log->mutex.
+ * Behavior:
+ *
+ * 	- O_NONBLOCK works
+ * 	- If there are no log entries to read, blocks until log is written to
+ * 	- Atomically reads exactly one log entry, or in batch mode
+ * 	  (LOGGER_SET_BATCH) as many whole entries as fit in the buffer
  *
- * Returns 'count' on success, negative error code on failure.
+ * Will set errno to EINVAL if read
+ * buffer is insufficient to hold next entry.
  */
-static ssize_t do_write_log_from_user(struct logger_log *log,
-				      const void __user *buf, size_t count)
+static ssize_t logger_read(struct file *file, char __user *buf,
+			   size_t count, loff_t *pos)
 {
-	size_t len;
+	struct logger_reader *reader = file->private_data;
+	struct logger_log *log = reader->log;
+	ssize_t ret;
 
-	len = min(count, log->size - log->w_off);
-	if (len && copy_from_user(log->buffer + log->w_off, buf, len))
-		return -EFAULT;
+	mutex_lock(&reader->mutex);
+	while (!next_record(log, reader)) {
+		u64 off = reader->r_off;
+
+		mutex_unlock(&reader->mutex);
+
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
+
+		if (wait_event_interruptible(log->wq, log_readable(log, off)))
+			return -EINTR;
+
+		mutex_lock(&reader->mutex);
+	}
+
+	/*
+	 * Get exactly one entry from the log or, in batch mode, as many
+	 * whole entries as are ready and fit.
+	 */
+	ret = 0;
+	do {
+		ssize_t len;
 
-	if (count != len)
-		if (copy_from_user(log->buffer, buf + len, count - len))
-			return -EFAULT;
+		len = get_user_hdr_len(reader->r_ver) + reader->rec.entry.len;
+		if (count < len) {
+			if (!ret)
+				ret = -EINVAL;
+			break;
+		}
+
+		len = do_read_log_to_user(reader, buf);
+		if (len < 0) {
+			if (!ret)
+				ret = len;
+			break;
+		}
+		buf += len;
+		count -= len;
+		ret += len;
+	} while (reader->r_batch && next_record(log, reader));
 
-	log->w_off = logger_offset(log->w_off + count);
+	mutex_unlock(&reader->mutex);
 
-	return count;
+	return ret;
 }
 
 /*
@@ -419,61 +752,67 @@ ssize_t logger_aio_write(struct kiocb *iocb, const struct iovec *iov,
 			 unsigned long nr_segs, loff_t ppos)
 {
 	struct logger_log *log = file_get_log(iocb->ki_filp);
-	size_t orig = log->w_off;
-	struct logger_entry header;
+	struct logger_record rec;
 	struct timespec now;
 	ssize_t ret = 0;
+	u64 pos, off;
 
 	now = current_kernel_time();
 
-	header.pid = current->tgid;
-	header.tid = current->pid;
-	header.sec = now.tv_sec;
-	header.nsec = now.tv_nsec;
-	header.euid = current_euid();
-	header.len = min_t(size_t, iocb->ki_left, LOGGER_ENTRY_MAX_PAYLOAD);
-	header.hdr_size = sizeof(struct logger_entry);
+	rec.entry.pid = current->tgid;
+	rec.entry.tid = current->pid;
+	rec.entry.sec = now.tv_sec;
+	rec.entry.nsec = now.tv_nsec;
+	rec.entry.euid = current_euid();
+	rec.entry.len = min_t(size_t, iocb->ki_left, LOGGER_ENTRY_MAX_PAYLOAD);
+	rec.entry.hdr_size = sizeof(struct logger_entry);
+	rec.size = ALIGN(sizeof(rec) + rec.entry.len, 8);
+	rec.flags = 0;
 
 	/* null writes succeed, return zero */
-	if (unlikely(!header.len))
+	if (unlikely(!rec.entry.len))
 		return 0;
 
-	mutex_lock(&log->mutex);
-
-	/*
-	 * Fix up any readers, pulling them forward to the first readable
-	 * entry after (what will be) the new write offset. We do this now
-	 * because if we partially fail, we can end up with clobbered log
-	 * entries that encroach on readable buffer.
-	 */
-	fix_up_readers(log, sizeof(struct logger_entry) + header.len);
-
-	do_write_log(log, &header, sizeof(struct logger_entry));
+	/* claim our space, then push the head past what we will overwrite */
+	pos = atomic64_add_return(rec.size, &log->w_off) - rec.size;
+	make_room(log, pos + rec.size);
 
+	off = pos + sizeof(rec);
 	while (nr_segs-- > 0) {
 		size_t len;
-		ssize_t nr;
 
 		/* figure out how much of this vector we can keep */
-		len = min_t(size_t, iov->iov_len, header.len - ret);
+		len = min_t(size_t, iov->iov_len, rec.entry.len - ret);
 
 		/* write out this segment's payload */
-		nr = do_write_log_from_user(log, iov->iov_base, len);
-		if (unlikely(nr < 0)) {
-			log->w_off = orig;
-			mutex_unlock(&log->mutex);
-			return nr;
+		if (unlikely(ring_write_from_user(log, off, iov->iov_base, len))) {
+			/* the space is claimed, so commit it as a hole */
+			rec.flags |= LOGGER_RECORD_DISCARD;
+			ret = -EFAULT;
+			break;
 		}
 
 		iov++;
-		ret += nr;
+		off += len;
+		ret += len;
 	}
 
-	mutex_unlock(&log->mutex);
+	rec.commit = commit_word(log, pos);
+	ring_write(log, pos + sizeof(rec.commit), &rec.size,
+		   sizeof(rec) - sizeof(rec.commit));
+	smp_wmb();
+	ACCESS_ONCE(*(u64 *) (log->buffer + logger_offset(pos))) = rec.commit;
+
+	/* wake up any writers waiting in make_room() for this record */
+	smp_mb();
+	if (waitqueue_active(&log->commit_wq))
+		wake_up(&log->commit_wq);
 
 	/* wake up any blocked readers */
 	wake_up_interruptible(&log->wq);
 
+	archive_kick(log, pos + rec.size);
+
 	return ret;
 }
 
@@ -508,11 +847,28 @@ static int logger_open(struct inode *inode, struct file *file)
 		reader->r_ver = 1;
 		reader->r_all = in_egroup_p(inode->i_gid) ||
 			capable(CAP_SYSLOG);
+		reader->r_have = false;
+		reader->r_batch = false;
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+		/* the archive's size is fixed at boot */
+		reader->zbuf = NULL;
+		reader->z_start = 0;
+		reader->z_end = 0;
+		if (log->archive.size) {
+			reader->zbuf = vmalloc(LOGGER_CHUNK_SIZE);
+			if (!reader->zbuf) {
+				kfree(reader);
+				return -ENOMEM;
+			}
+		}
+#endif
 
 		INIT_LIST_HEAD(&reader->list);
+		mutex_init(&reader->mutex);
 
+		/* the first read moves on to the oldest entry still kept */
 		mutex_lock(&log->mutex);
-		reader->r_off = log->head;
+		reader->r_off = log->flushed;
 		list_add_tail(&reader->list, &log->readers);
 		mutex_unlock(&log->mutex);
 
@@ -532,7 +888,14 @@ static int logger_release(struct inode *ignored, struct file *file)
 {
 	if (file->f_mode & FMODE_READ) {
 		struct logger_reader *reader = file->private_data;
+		struct logger_log *log = reader->log;
+
+		mutex_lock(&log->mutex);
 		list_del(&reader->list);
+		mutex_unlock(&log->mutex);
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+		vfree(reader->zbuf);
+#endif
 		kfree(reader);
 	}
 
@@ -543,10 +906,9 @@ static int logger_release(struct inode *ignored, struct file *file)
  * logger_poll - the log's poll file operation, for poll/select/epoll
  *
  * Note we always return POLLOUT, because you can always write() to the log.
- * Note also that, strictly speaking, a return value of POLLIN does not
- * guarantee that the log is readable without blocking, as there is a small
- * chance that the writer can lap the reader in the interim between poll()
- * returning and the read() request.
+ * A return value of POLLIN means the next entry has already been copied out
+ * of the ring, so the following read() will not block even if a writer laps
+ * the reader in the meantime.
  */
 static unsigned int logger_poll(struct file *file, poll_table *wait)
 {
@@ -562,18 +924,45 @@ static unsigned int logger_poll(struct file *file, poll_table *wait)
 
 	poll_wait(file, &log->wq, wait);
 
-	mutex_lock(&log->mutex);
-	if (!reader->r_all)
-		reader->r_off = get_next_entry_by_uid(log,
-			reader->r_off, current_euid());
-
-	if (log->w_off != reader->r_off)
+	mutex_lock(&reader->mutex);
+	if (next_record(log, reader))
 		ret |= POLLIN | POLLRDNORM;
-	mutex_unlock(&log->mutex);
+	mutex_unlock(&reader->mutex);
 
 	return ret;
 }
 
+/*
+ * logger_mmap - the log's mmap file operation
+ *
+ * Maps the whole ring read-only, for readers that may see every entry.
+ * Entries are found and validated as described for struct logger_record,
+ * with LOGGER_GET_CURSOR giving the key and the positions to start from and
+ * check against. The compressed archive is only reachable through read().
+ */
+static int logger_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct logger_reader *reader;
+	struct logger_log *log;
+
+	if (!(file->f_mode & FMODE_READ))
+		return -EBADF;
+
+	reader = file->private_data;
+	log = reader->log;
+
+	/* the ring holds every user's entries */
+	if (!reader->r_all)
+		return -EPERM;
+	if (vma->vm_flags & VM_WRITE)
+		return -EPERM;
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start != log->size)
+		return -EINVAL;
+
+	vma->vm_flags &= ~VM_MAYWRITE;
+	return remap_vmalloc_range(vma, log->buffer, 0);
+}
+
 static long logger_set_version(struct logger_reader *reader, void __user *arg)
 {
 	int version;
@@ -587,14 +976,90 @@ static long logger_set_version(struct logger_reader *reader, void __user *arg)
 	return 0;
 }
 
+static long logger_set_batch(struct logger_reader *reader, void __user *arg)
+{
+	int batch;
+	if (copy_from_user(&batch, arg, sizeof(int)))
+		return -EFAULT;
+
+	reader->r_batch = batch != 0;
+	return 0;
+}
+
+static long logger_get_cursor(struct logger_reader *reader, void __user *arg)
+{
+	struct logger_log *log = reader->log;
+	struct logger_cursor cursor;
+
+	cursor.head = atomic64_read(&log->head);
+	cursor.tail = atomic64_read(&log->w_off);
+	cursor.pos = reader->r_off;
+	if (pos_before(cursor.pos, cursor.head))
+		cursor.pos = cursor.head;
+	cursor.key = reader->r_all ? log->key : 0;
+
+	if (copy_to_user(arg, &cursor, sizeof(cursor)))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * logger_set_cursor - moves the reader to a position it reached through
+ * mmap, so poll() and read() carry on from there. The position must be
+ * that of a written record, or the tail; only 'r_all' readers can see
+ * them. A position the writers have lapped is accepted, and resyncs.
+ */
+static long logger_set_cursor(struct logger_reader *reader, void __user *arg)
+{
+	struct logger_log *log = reader->log;
+	u64 pos, tail;
+
+	if (!reader->r_all)
+		return -EPERM;
+	if (copy_from_user(&pos, arg, sizeof(pos)))
+		return -EFAULT;
+	tail = atomic64_read(&log->w_off);
+	if (!IS_ALIGNED(pos, 8) || pos_before(tail, pos))
+		return -EINVAL;
+	/* else a reader would wait in log_readable() until the ring laps */
+	if (pos != tail &&
+	    !pos_before(pos, atomic64_read(&log->head)) &&
+	    !ring_committed(log, pos))
+		return -EINVAL;
+
+	reader->r_off = pos;
+	reader->r_have = false;
+	return 0;
+}
+
+/*
+ * logger_flush - moves every reader, and any reader opened later, to the
+ * current end of the log.
+ */
+static void logger_flush(struct logger_log *log)
+{
+	struct logger_reader *reader;
+	u64 end;
+
+	mutex_lock(&log->mutex);
+	end = atomic64_read(&log->w_off);
+	list_for_each_entry(reader, &log->readers, list) {
+		mutex_lock(&reader->mutex);
+		reader->r_off = end;
+		reader->r_have = false;
+		mutex_unlock(&reader->mutex);
+	}
+	log->flushed = end;
+	mutex_unlock(&log->mutex);
+}
+
 static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 {
 	struct logger_log *log = file_get_log(file);
 	struct logger_reader *reader;
 	long ret = -EINVAL;
 	void __user *argp = (void __user *) arg;
-
-	mutex_lock(&log->mutex);
+	u64 start;
 
 	switch (cmd) {
 	case LOGGER_GET_LOG_BUF_SIZE:
@@ -606,10 +1071,12 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
-		if (log->w_off >= reader->r_off)
-			ret = log->w_off - reader->r_off;
-		else
-			ret = (log->size - reader->r_off) + log->w_off;
+		mutex_lock(&reader->mutex);
+		start = reader->r_off;
+		mutex_unlock(&reader->mutex);
+		if (pos_before(start, atomic64_read(&log->head)))
+			start = atomic64_read(&log->head);
+		ret = min_t(u64, atomic64_read(&log->w_off) - start, log->size);
 		break;
 	case LOGGER_GET_NEXT_ENTRY_LEN:
 		if (!(file->f_mode & FMODE_READ)) {
@@ -618,24 +1085,20 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 		}
 		reader = file->private_data;
 
-		if (!reader->r_all)
-			reader->r_off = get_next_entry_by_uid(log,
-				reader->r_off, current_euid());
-
-		if (log->w_off != reader->r_off)
+		mutex_lock(&reader->mutex);
+		if (next_record(log, reader))
 			ret = get_user_hdr_len(reader->r_ver) +
-				get_entry_msg_len(log, reader->r_off);
+				reader->rec.entry.len;
 		else
 			ret = 0;
+		mutex_unlock(&reader->mutex);
 		break;
 	case LOGGER_FLUSH_LOG:
 		if (!(file->f_mode & FMODE_WRITE)) {
 			ret = -EBADF;
 			break;
 		}
-		list_for_each_entry(reader, &log->readers, list)
-			reader->r_off = log->w_off;
-		log->head = log->w_off;
+		logger_flush(log);
 		ret = 0;
 		break;
 	case LOGGER_GET_VERSION:
@@ -652,12 +1115,42 @@ static long logger_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
 			break;
 		}
 		reader = file->private_data;
+		mutex_lock(&reader->mutex);
 		ret = logger_set_version(reader, argp);
+		mutex_unlock(&reader->mutex);
+		break;
+	case LOGGER_SET_BATCH:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		mutex_lock(&reader->mutex);
+		ret = logger_set_batch(reader, argp);
+		mutex_unlock(&reader->mutex);
+		break;
+	case LOGGER_GET_CURSOR:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		mutex_lock(&reader->mutex);
+		ret = logger_get_cursor(reader, argp);
+		mutex_unlock(&reader->mutex);
+		break;
+	case LOGGER_SET_CURSOR:
+		if (!(file->f_mode & FMODE_READ)) {
+			ret = -EBADF;
+			break;
+		}
+		reader = file->private_data;
+		mutex_lock(&reader->mutex);
+		ret = logger_set_cursor(reader, argp);
+		mutex_unlock(&reader->mutex);
 		break;
 	}
 
-	mutex_unlock(&log->mutex);
-
 	return ret;
 }
 
@@ -666,6 +1159,7 @@ static const struct file_operations logger_fops = {
 	.read = logger_read,
 	.aio_write = logger_aio_write,
 	.poll = logger_poll,
+	.mmap = logger_mmap,
 	.unlocked_ioctl = logger_ioctl,
 	.compat_ioctl = logger_ioctl,
 	.open = logger_open,
@@ -673,14 +1167,49 @@ static const struct file_operations logger_fops = {
 };
 
 /*
- * Defines a log structure with name 'NAME' and a size of 'SIZE' bytes, which
- * must be a power of two, and greater than
- * (LOGGER_ENTRY_MAX_PAYLOAD + sizeof(struct logger_entry)).
+ * logger_set_size - sets a log or archive size from the kernel command line,
+ * accepting K and M suffixes, as in "logger.log_main_size=1M".
  */
-#define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE) \
-static unsigned char _buf_ ## VAR[SIZE]; \
+static int logger_set_size(const char *val, const struct kernel_param *kp)
+{
+	size_t *size = kp->arg;
+	char *end;
+
+	*size = memparse(val, &end);
+	if (*end && *end != '\n')
+		return -EINVAL;
+	return 0;
+}
+
+static int logger_get_size(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%zu", *(size_t *) kp->arg);
+}
+
+static struct kernel_param_ops logger_size_ops = {
+	.set = logger_set_size,
+	.get = logger_get_size,
+};
+
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+#define LOGGER_ARCHIVE_INIT(ZSIZE) .archive = { .size = ZSIZE },
+#define LOGGER_ARCHIVE_PARAM(VAR) \
+module_param_cb(VAR ## _compressed_size, &logger_size_ops, \
+		&VAR.archive.size, S_IRUGO);
+#else
+#define LOGGER_ARCHIVE_INIT(ZSIZE)
+#define LOGGER_ARCHIVE_PARAM(VAR)
+#endif
+
+/*
+ * Defines a log structure with name 'NAME', a default size of 'SIZE' bytes
+ * and, with CONFIG_ANDROID_LOGGER_COMPRESS, a default archive of 'ZSIZE'
+ * bytes. Both can be set at boot with logger.VAR_size and
+ * logger.VAR_compressed_size; an archive size of 0 turns compression off
+ * for that log. The ring is allocated in init_log().
+ */
+#define DEFINE_LOGGER_DEVICE(VAR, NAME, SIZE, ZSIZE) \
 static struct logger_log VAR = { \
-	.buffer = _buf_ ## VAR, \
 	.misc = { \
 		.minor = MISC_DYNAMIC_MINOR, \
 		.name = NAME, \
@@ -688,17 +1217,19 @@ static struct logger_log VAR = { \
 		.parent = NULL, \
 	}, \
 	.wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .wq), \
+	.commit_wq = __WAIT_QUEUE_HEAD_INITIALIZER(VAR .commit_wq), \
 	.readers = LIST_HEAD_INIT(VAR .readers), \
 	.mutex = __MUTEX_INITIALIZER(VAR .mutex), \
-	.w_off = 0, \
-	.head = 0, \
 	.size = SIZE, \
-};
+	LOGGER_ARCHIVE_INIT(ZSIZE) \
+}; \
+module_param_cb(VAR ## _size, &logger_size_ops, &VAR.size, S_IRUGO); \
+LOGGER_ARCHIVE_PARAM(VAR)
 
-DEFINE_LOGGER_DEVICE(log_main, LOGGER_LOG_MAIN, 256*1024)
-DEFINE_LOGGER_DEVICE(log_events, LOGGER_LOG_EVENTS, 256*1024)
-DEFINE_LOGGER_DEVICE(log_radio, LOGGER_LOG_RADIO, 256*1024)
-DEFINE_LOGGER_DEVICE(log_system, LOGGER_LOG_SYSTEM, 256*1024)
+DEFINE_LOGGER_DEVICE(log_main, LOGGER_LOG_MAIN, 256*1024, 512*1024)
+DEFINE_LOGGER_DEVICE(log_events, LOGGER_LOG_EVENTS, 256*1024, 256*1024)
+DEFINE_LOGGER_DEVICE(log_radio, LOGGER_LOG_RADIO, 256*1024, 256*1024)
+DEFINE_LOGGER_DEVICE(log_system, LOGGER_LOG_SYSTEM, 256*1024, 256*1024)
 
 static struct logger_log *get_log_from_minor(int minor)
 {
@@ -717,6 +1248,27 @@ static int __init init_log(struct logger_log *log)
 {
 	int ret;
 
+	/*
+	 * The ring must be a power of two, and is zeroed and mappable by
+	 * readers.  Positions are 8-byte aligned and the key has its low bit
+	 * set, so no commit word is 0 and the zeroed fresh ring never looks
+	 * written.  Positions still start at 'size' rather than 0.
+	 */
+	log->size = roundup_pow_of_two(max_t(size_t, log->size,
+					     LOGGER_MIN_SIZE));
+	log->buffer = vmalloc_user(log->size);
+	if (!log->buffer) {
+		printk(KERN_ERR "logger: failed to allocate log '%s'!\n",
+		       log->misc.name);
+		return -ENOMEM;
+	}
+	get_random_bytes(&log->key, sizeof(log->key));
+	log->key |= 1;
+	atomic64_set(&log->w_off, log->size);
+	atomic64_set(&log->head, log->size);
+	log->flushed = log->size;
+	archive_init(log);
+
 	ret = misc_register(&log->misc);
 	if (unlikely(ret)) {
 		printk(KERN_ERR "logger: failed to register misc "
@@ -726,6 +1278,12 @@ static int __init init_log(struct logger_log *log)
 
 	printk(KERN_INFO "logger: created %luK log '%s'\n",
 	       (unsigned long) log->size >> 10, log->misc.name);
+#ifdef CONFIG_ANDROID_LOGGER_COMPRESS
+	if (log->archive.size)
+		printk(KERN_INFO "logger: keeping %luK of compressed "
+		       "entries for log '%s'\n",
+		       (unsigned long) log->archive.size >> 10, log->misc.name);
+#endif
 
 	return 0;
 }
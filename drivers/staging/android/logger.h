@@ -51,6 +51,36 @@ struct logger_entry {
 	char		msg[0];		/* the entry's payload */
 };
 
+/*
+ * struct logger_record - a log entry as stored in the ring, which readers
+ * may map read-only with mmap()
+ *
+ * Positions in a log only ever grow; a record at position 'pos' starts at
+ * offset pos % size of the ring.  Records are 8-byte aligned and may wrap
+ * around the end of the ring.  A record is written once 'commit' equals its
+ * position XOR the log's key, and a copy of it is valid if the log's head,
+ * as returned by LOGGER_GET_CURSOR, has not passed it once the copy is done.
+ */
+struct logger_record {
+	__u64			commit;	/* position ^ key, once written */
+	__u16			size;	/* bytes to the next record */
+	__u16			flags;	/* LOGGER_RECORD_* */
+	struct logger_entry	entry;	/* the entry's header */
+} __attribute__((aligned(8)));
+
+#define LOGGER_RECORD_DISCARD	0x1	/* the write faulted; skip this record */
+
+/*
+ * The cursor of a reader, for LOGGER_GET_CURSOR.  The first three are
+ * positions; 'key' is only given to readers that may map the ring.
+ */
+struct logger_cursor {
+	__u64		head;	/* oldest record still in the ring */
+	__u64		tail;	/* end of the last record claimed by a writer */
+	__u64		pos;	/* the reader's next record */
+	__u64		key;	/* the log's commit key, or 0 */
+};
+
 #define LOGGER_LOG_RADIO	"log_radio"	/* radio-related messages */
 #define LOGGER_LOG_EVENTS	"log_events"	/* system/hardware events */
 #define LOGGER_LOG_SYSTEM	"log_system"	/* system/framework messages */
@@ -66,5 +96,8 @@ struct logger_entry {
 #define LOGGER_FLUSH_LOG		_IO(__LOGGERIO, 4) /* flush log */
 #define LOGGER_GET_VERSION		_IO(__LOGGERIO, 5) /* abi version */
 #define LOGGER_SET_VERSION		_IO(__LOGGERIO, 6) /* abi version */
+#define LOGGER_SET_BATCH		_IO(__LOGGERIO, 7) /* many per read */
+#define LOGGER_GET_CURSOR		_IOR(__LOGGERIO, 8, struct logger_cursor)
+#define LOGGER_SET_CURSOR		_IOW(__LOGGERIO, 9, __u64)
 
 #endif /* _LINUX_LOGGER_H */
@@ -39,6 +39,8 @@
 #include <asm/mman.h>
 #include <asm/atomic.h>
 
+#include <eventlogging/events.h>
+
 /*
  * LOCKING:
  * There are three level of locking required by epoll :
@@ -847,6 +849,23 @@ static struct epitem *ep_find(struct eventpoll *ep, struct file *file, int fd)
 	return epir;
 }
 
+/*
+ * Logs which waiter a ready file is about to wake.  Only ep_poll()
+ * waits on ep->wq, and it waits exclusively, so the first entry is
+ * the task that wake_up_locked() will wake.  Must be called with
+ * ep->lock held.
+ */
+static inline void ep_log_notify(struct eventpoll *ep, struct epitem *epi)
+{
+#ifdef CONFIG_EVENT_EPOLL_NOTIFY
+	wait_queue_t *curr = list_first_entry(&ep->wq.task_list,
+					      wait_queue_t, task_list);
+
+	event_log_epoll_notify(ep, ((struct task_struct *)curr->private)->pid,
+			       epi->ffd.fd);
+#endif
+}
+
 /*
  * This is the callback that is passed to the wait queue wakeup
  * mechanism. It is called by the stored file descriptors when they
@@ -912,8 +931,10 @@ static int ep_poll_callback(wait_queue_t *wait, unsigned mode, int sync, void *k
 	 * Wake up ( if active ) both the eventpoll wait list and the ->poll()
 	 * wait list.
 	 */
-	if (waitqueue_active(&ep->wq))
+	if (waitqueue_active(&ep->wq)) {
+		ep_log_notify(ep, epi);
 		wake_up_locked(&ep->wq);
+	}
 	if (waitqueue_active(&ep->poll_wait))
 		pwake++;
 
@@ -1381,8 +1402,10 @@ fetch_events:
 			}
 
 			spin_unlock_irqrestore(&ep->lock, flags);
+			event_log_epoll_wait(ep);
 			if (!schedule_hrtimeout_range(to, slack, HRTIMER_MODE_ABS))
 				timed_out = 1;
+			event_log_epoll_wake(ep);
 
 			spin_lock_irqsave(&ep->lock, flags);
 		}
@@ -1405,6 +1428,7 @@ check_events:
 	    !(res = ep_send_events(ep, events, maxevents)) && !timed_out)
 		goto fetch_events;
 
+	event_log_epoll_return(ep, res);
 	return res;
 }
 
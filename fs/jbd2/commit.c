@@ -28,6 +28,7 @@
 #include <linux/blkdev.h>
 #include <linux/bitops.h>
 #include <trace/events/jbd2.h>
+#include <eventlogging/events.h>
 #include <asm/system.h>
 
 /*
@@ -352,6 +353,8 @@ void jbd2_journal_commit_transaction(journal_t *journal)
 	J_ASSERT(commit_transaction->t_state == T_RUNNING);
 
 	trace_jbd2_start_commit(journal, commit_transaction);
+	event_log_journal_commit_start(journal->j_fs_dev->bd_dev,
+				       commit_transaction->t_tid);
 	jbd_debug(1, "JBD: starting commit of transaction %d\n",
 			commit_transaction->t_tid);
 
@@ -1039,6 +1042,9 @@ restart_loop:
 		journal->j_commit_callback(journal, commit_transaction);
 
 	trace_jbd2_end_commit(journal, commit_transaction);
+	event_log_journal_commit_end(journal->j_fs_dev->bd_dev,
+				     commit_transaction->t_tid,
+				     stats.run.rs_blocks_logged);
 	jbd_debug(1, "JBD: commit %d complete, head %d\n",
 		  journal->j_commit_sequence, journal->j_tail_sequence);
 	if (to_free)
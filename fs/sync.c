@@ -16,6 +16,7 @@
 #include <linux/quotaops.h>
 #include <linux/buffer_head.h>
 #include <linux/backing-dev.h>
+#include <eventlogging/events.h>
 #include "internal.h"
 
 #define VALID_FLAGS (SYNC_FILE_RANGE_WAIT_BEFORE|SYNC_FILE_RANGE_WRITE| \
@@ -211,7 +212,11 @@ static int do_fsync(unsigned int fd, int datasync)
 
 	file = fget(fd);
 	if (file) {
+		struct inode *inode = file->f_mapping->host;
+
+		event_log_fsync_begin(inode->i_sb->s_dev, inode->i_ino, datasync);
 		ret = vfs_fsync(file, datasync);
+		event_log_fsync_end(inode->i_sb->s_dev, inode->i_ino, datasync, ret);
 		fput(file);
 	}
 	return ret;
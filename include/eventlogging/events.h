@@ -7,6 +7,9 @@
 
 #define EVENT_SYNC_LOG 0
 #define EVENT_MISSED_COUNT 1
+#define EVENT_SAMPLE_RATE 2
+#define EVENT_RATE_LIMITED 3
+#define EVENT_BENCH 4  // written only by the cache benchmark
 
 #define EVENT_CPU_ONLINE 5
 #define EVENT_CPU_DOWN_PREPARE 6
@@ -26,6 +29,11 @@
 
 #define EVENT_IO_BLOCK 20
 #define EVENT_IO_RESUME 21
+#define EVENT_BLOCK_RQ_INSERT 22
+#define EVENT_BLOCK_RQ_DISPATCH 23
+#define EVENT_BLOCK_RQ_COMPLETE 24
+#define EVENT_PAGE_FAULT_ENTRY 25
+#define EVENT_PAGE_FAULT_EXIT 26
 
 #define EVENT_DATAGRAM_BLOCK 30
 #define EVENT_DATAGRAM_RESUME 31
@@ -33,6 +41,8 @@
 #define EVENT_STREAM_RESUME 33
 #define EVENT_SOCK_BLOCK 34
 #define EVENT_SOCK_RESUME 35
+#define EVENT_NET_RX 36
+#define EVENT_SOCK_DATA_READY 37
 
 #define EVENT_SEMAPHORE_LOCK 40
 #define EVENT_SEMAPHORE_WAIT 41
@@ -52,6 +62,11 @@
 #define EVENT_WAITQUEUE_WAKE 56
 #define EVENT_WAITQUEUE_NOTIFY 57
 
+#define EVENT_EPOLL_WAIT 65
+#define EVENT_EPOLL_WAKE 66
+#define EVENT_EPOLL_NOTIFY 67
+#define EVENT_EPOLL_RETURN 68
+
 #define EVENT_IPC_LOCK 60
 #define EVENT_IPC_WAIT 61
 
@@ -62,6 +77,18 @@
 #define EVENT_SUSPEND 76
 #define EVENT_RESUME 77
 #define EVENT_RESUME_FINISH 78
+#define EVENT_CLOCK_ANCHOR 79
+
+#define EVENT_RWSEM_READ_WAIT 80
+#define EVENT_RWSEM_READ_WAKE 81
+#define EVENT_RWSEM_READ_NOTIFY 82
+#define EVENT_RWSEM_WRITE_WAIT 83
+#define EVENT_RWSEM_WRITE_WAKE 84
+#define EVENT_RWSEM_WRITE_NOTIFY 85
+
+#define EVENT_RTMUTEX_WAIT 86
+#define EVENT_RTMUTEX_WAKE 87
+#define EVENT_RTMUTEX_NOTIFY 88
 
 #define EVENT_BINDER_PRODUCE_ONEWAY 90
 #define EVENT_BINDER_PRODUCE_TWOWAY 91
@@ -74,6 +101,29 @@
 #define EVENT_CPUFREQ_DEL_TIMER 103
 #define EVENT_CPUFREQ_TIMER 104
 
+#define EVENT_INPUT_EVENT 105
+#define EVENT_INPUT_READ 106
+
+#define EVENT_HARDIRQ_ENTRY 110
+#define EVENT_HARDIRQ_EXIT 111
+#define EVENT_SOFTIRQ_ENTRY 112
+#define EVENT_SOFTIRQ_EXIT 113
+
+#define EVENT_WORK_QUEUE 114
+#define EVENT_WORK_START 115
+#define EVENT_WORK_END 116
+
+#define EVENT_RECLAIM_BEGIN 120
+#define EVENT_RECLAIM_END 121
+#define EVENT_KSWAPD_WAKE 122
+#define EVENT_KSWAPD_SLEEP 123
+#define EVENT_LOWMEM_KILL 124
+
+#define EVENT_FSYNC_BEGIN 125
+#define EVENT_FSYNC_END 126
+#define EVENT_JOURNAL_COMMIT_START 127
+#define EVENT_JOURNAL_COMMIT_END 128
+
 #define MAX8 ((1 << 7) - 1)
 #define MIN8 (-(1 << 7))
 
@@ -126,6 +176,32 @@ struct missed_count_event {
   __le32 count;
 }__attribute__((packed));
 
+/* Only 1 in 'rate' events of 'event_type', and at most 'limit' per
+ * second per cpu (0 is unlimited), are logged from here on.
+ */
+struct sample_rate_event {
+  __u8 event_type;
+  __le32 rate;
+  __le32 limit;
+}__attribute__((packed));
+
+/* 'dropped' events of 'event_type' were not logged due to the rate limit */
+struct rate_limited_event {
+  __u8 event_type;
+  __le32 dropped;
+}__attribute__((packed));
+
+/* Absolute monotonic and wall clock times, logged periodically on
+ * every cpu and around suspend, so the per-cpu streams can be merged
+ * exactly.  The record's own timestamp is absolute, not a delta.
+ */
+struct clock_anchor_event {
+  __le32 mono_sec;
+  __le32 mono_nsec;
+  __le32 wall_sec;
+  __le32 wall_nsec;
+}__attribute__((packed));
+
 struct context_switch_event {
   __le16 new_pid;
   __u8   state;  
@@ -169,6 +245,65 @@ struct general_notify_event {
   __le16 pid;
 }__attribute__((packed));
 
+struct epoll_notify_event {
+  __le32 epoll;          // the eventpoll instance, as in the wait and wake events
+  __le16 pid;            // the waiter being woken
+  __le32 fd;             // the file descriptor that became ready
+}__attribute__((packed));
+
+struct epoll_return_event {
+  __le32 epoll;
+  __le32 ready;          // events returned, or a negative error
+}__attribute__((packed));
+
+/* Sectors are logged in buckets of 2^11 sectors (1 MB) */
+#define BLOCK_SECTOR_BUCKET_SHIFT 11
+
+#define BLOCK_RQ_WRITE   0x01
+#define BLOCK_RQ_SYNC    0x02
+#define BLOCK_RQ_META    0x04
+#define BLOCK_RQ_FLUSH   0x08
+#define BLOCK_RQ_DISCARD 0x10
+#define BLOCK_RQ_ERROR   0x80  // completed with an error
+
+struct block_rq_event {
+  __le32 request;        // request address, the id linking its events
+  __le32 dev;
+  __le32 sector_bucket;
+  __le32 bytes;          // request size, or bytes completed
+  __u8 flags;
+}__attribute__((packed));
+
+#define PAGE_FAULT_MAJOR 0x01  // needed IO
+#define PAGE_FAULT_FILE  0x02  // file-backed, not anonymous, mapping
+#define PAGE_FAULT_WRITE 0x04
+#define PAGE_FAULT_USER  0x08  // from user mode
+#define PAGE_FAULT_ERROR 0x80  // not handled; signal or kernel fixup follows
+
+struct page_fault_entry_event {
+  __le32 address;
+}__attribute__((packed));
+
+struct page_fault_exit_event {
+  __le32 address;
+  __u8 flags;
+}__attribute__((packed));
+
+struct sock_event {
+  __le32 sock;           // struct sock address, the id linking socket events
+}__attribute__((packed));
+
+struct net_rx_event {
+  __le32 skb;
+  __le16 ifindex;
+  __le16 len;
+}__attribute__((packed));
+
+struct sock_data_ready_event {
+  __le32 sock;
+  __le32 len;            // bytes made available
+}__attribute__((packed));
+
 struct binder_event {
   __le32 transaction;
 }__attribute__((packed));
@@ -182,6 +317,71 @@ struct cpufreq_timer_event {
   __u8 cpu;
 }__attribute__((packed));
 
+struct input_event_event {
+  __u8 dev;              // evdev minor, as in /dev/input/eventN
+  __u8 type;
+  __le16 code;
+  __le32 value;
+}__attribute__((packed));
+
+struct input_read_event {
+  __u8 dev;
+  __le16 count;          // input events dequeued by this read
+}__attribute__((packed));
+
+struct hardirq_event {
+  __le16 irq;
+}__attribute__((packed));
+
+struct softirq_event {
+  __u8 vec;
+}__attribute__((packed));
+
+struct work_event {
+  __le32 work;
+  __le32 func;
+}__attribute__((packed));
+
+struct reclaim_begin_event {
+  __u8 order;
+}__attribute__((packed));
+
+struct reclaim_end_event {
+  __le32 scanned;        // pages
+  __le32 reclaimed;      // pages
+}__attribute__((packed));
+
+struct kswapd_event {
+  __u8 node;
+  __u8 order;
+}__attribute__((packed));
+
+struct lowmem_kill_event {
+  __le16 pid;
+  __s16 oom_adj;
+  __le32 tasksize;       // resident pages
+}__attribute__((packed));
+
+#define FSYNC_DATASYNC 0x01
+#define FSYNC_ERROR    0x80  // end only
+
+struct fsync_event {
+  __le32 dev;
+  __le32 inode;
+  __u8 flags;
+}__attribute__((packed));
+
+struct journal_commit_start_event {
+  __le32 dev;            // the device of the journaled filesystem
+  __le32 tid;
+}__attribute__((packed));
+
+struct journal_commit_end_event {
+  __le32 dev;
+  __le32 tid;
+  __le32 blocks;         // journal blocks written
+}__attribute__((packed));
+
 struct simple_event {
 }__attribute__((packed));
 
@@ -193,11 +393,39 @@ struct simple_event {
 #include <linux/smp.h>
 
 #ifdef CONFIG_EVENT_LOGGING
-extern void* reserve_event(int len);
+extern void* reserve_event(u8 event_type, int len);
+extern void replicate_event(struct event_hdr* header, void* payload, int len, int diff);
+extern int event_log_multi_session;
 extern void shrink_event(int len);
 extern void poke_queues(void);
 extern struct timeval* get_timestamp(void);
 
+#ifdef CONFIG_EVENT_LOGGING_SAMPLING
+extern int event_log_sampling_active;
+extern int __event_log_sample(u8 event_type);
+
+/* Returns non-zero if an event of this type should be logged. */
+static inline int event_log_sample(u8 event_type) {
+  if (likely(!event_log_sampling_active))
+    return 1;
+  return __event_log_sample(event_type);
+}
+#else
+static inline int event_log_sample(u8 event_type) {
+  return 1;
+}
+#endif
+
+#ifdef CONFIG_EVENT_LOGGING_AGGREGATE
+extern int event_log_aggregating;
+extern void event_agg_lock(u8 event_type, void* lock);
+extern void event_agg_binder(u8 event_type, void* transaction);
+#else
+#define event_log_aggregating 0
+static inline void event_agg_lock(u8 event_type, void* lock) {}
+static inline void event_agg_binder(u8 event_type, void* transaction) {}
+#endif
+
 #define __init_event(type, event_type, name, diff)			\
   struct timeval tv;							\
   u8 sec_len;								\
@@ -207,8 +435,12 @@ extern struct timeval* get_timestamp(void);
   char* usec;								\
   type* name;								\
   unsigned long flags;							\
+  const int __payload_len = sizeof(*name);				\
+  const int __diff = diff;						\
   local_irq_save(flags);						\
-  header = (typeof(header)) reserve_event(sizeof(*header) + 4 + 3 + sizeof(*name)); \
+  header = NULL;							\
+  if (event_log_sample(event_type))					\
+    header = (typeof(header)) reserve_event(event_type, sizeof(*header) + 4 + 3 + __payload_len); \
   if (header) {								\
   tv = event_log_timestamp(diff);					\
   if (diff) {								\
@@ -228,11 +460,18 @@ extern struct timeval* get_timestamp(void);
 
 #define init_event(type, event_type, name) __init_event(type, event_type, name, 1)
 
-#define finish_event() poke_queues(); \
-  }				      \
+/* Copies the record to any other sessions that want it */
+#define __commit_event()					\
+  if (unlikely(event_log_multi_session))			\
+    replicate_event(header, usec + usec_len, __payload_len, __diff)
+
+#define finish_event() __commit_event(); \
+  poke_queues();			 \
+  }					 \
  local_irq_restore(flags)
 
-#define finish_event_no_poke() }      \
+#define finish_event_no_poke() __commit_event(); \
+  }					         \
     local_irq_restore(flags)
 
 /* Records the current timestamp and, if diff is true, returns the
@@ -301,7 +540,45 @@ static inline void event_log_missed_count(int* count) {
   finish_event_no_poke();
 }
 
+static inline void event_log_clock_anchor(void) {
+  struct timespec mono, wall;
+  __init_event(struct clock_anchor_event, EVENT_CLOCK_ANCHOR, event, 0);
+  ktime_get_ts(&mono);
+  getnstimeofday(&wall);
+  event->mono_sec = mono.tv_sec;
+  event->mono_nsec = mono.tv_nsec;
+  event->wall_sec = wall.tv_sec;
+  event->wall_nsec = wall.tv_nsec;
+  finish_event_no_poke();
+}
+
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+/* Makes every cpu log a clock anchor before its next event */
+extern void event_log_resync_clocks(void);
+#else
+static inline void event_log_resync_clocks(void) {}
+#endif
+
+static inline void event_log_sample_rate(u8 event_type, u32 rate, u32 limit) {
+  init_event(struct sample_rate_event, EVENT_SAMPLE_RATE, event);
+  event->event_type = event_type;
+  event->rate = rate;
+  event->limit = limit;
+  finish_event_no_poke();
+}
+
+static inline void event_log_rate_limited(u8 event_type, u32 dropped) {
+  init_event(struct rate_limited_event, EVENT_RATE_LIMITED, event);
+  event->event_type = event_type;
+  event->dropped = dropped;
+  finish_event_no_poke();
+}
+
 static inline void event_log_general_lock(__u8 event_type, void* lock) {
+  if (unlikely(event_log_aggregating)) {
+    event_agg_lock(event_type, lock);
+    return;
+  }
   init_event(struct general_lock_event, event_type, event);
   event->lock = (__le32) lock;
   finish_event_no_poke();
@@ -372,6 +649,10 @@ static inline void event_log_cpu_dead(unsigned int cpu) {
 #if defined(CONFIG_EVENT_BINDER_PRODUCE_ONEWAY) || defined(CONFIG_EVENT_BINDER_PRODUCE_TWOWAY) \
  || defined(CONFIG_EVENT_BINDER_PRODUCE_REPLY) || defined(CONFIG_EVENT_BINDER_CONSUME)
 static inline void event_log_binder(u8 event_type, void* transaction) {
+  if (unlikely(event_log_aggregating)) {
+    event_agg_binder(event_type, transaction);
+    return;
+  }
   init_event(struct binder_event, event_type, event);
   event->transaction = (__le32) transaction;
   finish_event();
@@ -431,56 +712,98 @@ static inline void event_log_suspend_start(void) {
 }
 
 static inline void event_log_suspend(void) {
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+  event_log_clock_anchor();
+#endif
 #ifdef CONFIG_EVENT_SUSPEND
   event_log_simple_no_poke(EVENT_SUSPEND);
 #endif
 }
 
 static inline void event_log_resume(void) {
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+  event_log_resync_clocks();
+#endif
 #ifdef CONFIG_EVENT_RESUME
   event_log_simple_no_poke(EVENT_RESUME);
 #endif
 }
 
+static inline void event_log_clock_was_set(void) {
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+  event_log_resync_clocks();
+#endif
+}
+
 static inline void event_log_resume_finish(void) {
 #ifdef CONFIG_EVENT_RESUME_FINISH
   event_log_simple_no_poke(EVENT_RESUME_FINISH);
 #endif
 }
 
-static inline void event_log_datagram_block(void) {
+#if defined(CONFIG_EVENT_DATAGRAM_BLOCK) || defined(CONFIG_EVENT_DATAGRAM_RESUME) \
+  || defined(CONFIG_EVENT_STREAM_BLOCK) || defined(CONFIG_EVENT_STREAM_RESUME) \
+  || defined(CONFIG_EVENT_SOCK_BLOCK) || defined(CONFIG_EVENT_SOCK_RESUME)
+static inline void event_log_sock(__u8 event_type, void* sock) {
+  init_event(struct sock_event, event_type, event);
+  event->sock = (__le32) sock;
+  finish_event();
+}
+#endif
+
+static inline void event_log_datagram_block(void* sock) {
 #ifdef CONFIG_EVENT_DATAGRAM_BLOCK
-  event_log_simple(EVENT_DATAGRAM_BLOCK);
+  event_log_sock(EVENT_DATAGRAM_BLOCK, sock);
 #endif
 }
 
-static inline void event_log_datagram_resume(void) {
+static inline void event_log_datagram_resume(void* sock) {
 #ifdef CONFIG_EVENT_DATAGRAM_RESUME
-  event_log_simple(EVENT_DATAGRAM_RESUME);
+  event_log_sock(EVENT_DATAGRAM_RESUME, sock);
 #endif
 }
 
-static inline void event_log_stream_block(void) {
+static inline void event_log_stream_block(void* sock) {
 #ifdef CONFIG_EVENT_STREAM_BLOCK
-  event_log_simple(EVENT_STREAM_BLOCK);
+  event_log_sock(EVENT_STREAM_BLOCK, sock);
 #endif
 }
 
-static inline void event_log_stream_resume(void) {
+static inline void event_log_stream_resume(void* sock) {
 #ifdef CONFIG_EVENT_STREAM_RESUME
-  event_log_simple(EVENT_STREAM_RESUME);
+  event_log_sock(EVENT_STREAM_RESUME, sock);
 #endif
 }
 
-static inline void event_log_sock_block(void) {
+static inline void event_log_sock_block(void* sock) {
 #ifdef CONFIG_EVENT_SOCK_BLOCK
-  event_log_simple(EVENT_SOCK_BLOCK);
+  event_log_sock(EVENT_SOCK_BLOCK, sock);
 #endif
 }
 
-static inline void event_log_sock_resume(void) {
+static inline void event_log_sock_resume(void* sock) {
 #ifdef CONFIG_EVENT_SOCK_RESUME
-  event_log_simple(EVENT_SOCK_RESUME);
+  event_log_sock(EVENT_SOCK_RESUME, sock);
+#endif
+}
+
+/* Both are logged from softirq for every packet, so they don't poke the queues */
+static inline void event_log_net_rx(void* skb, int ifindex, unsigned int len) {
+#ifdef CONFIG_EVENT_NET_RX
+  init_event(struct net_rx_event, EVENT_NET_RX, event);
+  event->skb = (__le32) skb;
+  event->ifindex = ifindex;
+  event->len = len;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_sock_data_ready(void* sock, int len) {
+#ifdef CONFIG_EVENT_SOCK_DATA_READY
+  init_event(struct sock_data_ready_event, EVENT_SOCK_DATA_READY, event);
+  event->sock = (__le32) sock;
+  event->len = len;
+  finish_event_no_poke();
 #endif
 }
 
@@ -496,6 +819,58 @@ static inline void event_log_io_resume(void) {
 #endif
 }
 
+#if defined(CONFIG_EVENT_BLOCK_RQ_INSERT) || defined(CONFIG_EVENT_BLOCK_RQ_DISPATCH) \
+ || defined(CONFIG_EVENT_BLOCK_RQ_COMPLETE)
+static inline void event_log_block_rq(u8 event_type, void* request, u32 dev, u64 sector,
+				      unsigned int bytes, u8 flags) {
+  init_event(struct block_rq_event, event_type, event);
+  event->request = (__le32) request;
+  event->dev = dev;
+  event->sector_bucket = (u32) (sector >> BLOCK_SECTOR_BUCKET_SHIFT);
+  event->bytes = bytes;
+  event->flags = flags;
+  finish_event();
+}
+#endif
+
+static inline void event_log_block_rq_insert(void* request, u32 dev, u64 sector,
+					     unsigned int bytes, u8 flags) {
+#ifdef CONFIG_EVENT_BLOCK_RQ_INSERT
+  event_log_block_rq(EVENT_BLOCK_RQ_INSERT, request, dev, sector, bytes, flags);
+#endif
+}
+
+static inline void event_log_block_rq_dispatch(void* request, u32 dev, u64 sector,
+					       unsigned int bytes, u8 flags) {
+#ifdef CONFIG_EVENT_BLOCK_RQ_DISPATCH
+  event_log_block_rq(EVENT_BLOCK_RQ_DISPATCH, request, dev, sector, bytes, flags);
+#endif
+}
+
+static inline void event_log_block_rq_complete(void* request, u32 dev, u64 sector,
+					       unsigned int bytes, u8 flags) {
+#ifdef CONFIG_EVENT_BLOCK_RQ_COMPLETE
+  event_log_block_rq(EVENT_BLOCK_RQ_COMPLETE, request, dev, sector, bytes, flags);
+#endif
+}
+
+static inline void event_log_page_fault_entry(unsigned long address) {
+#ifdef CONFIG_EVENT_PAGE_FAULT_ENTRY
+  init_event(struct page_fault_entry_event, EVENT_PAGE_FAULT_ENTRY, event);
+  event->address = address;
+  finish_event();
+#endif
+}
+
+static inline void event_log_page_fault_exit(unsigned long address, u8 flags) {
+#ifdef CONFIG_EVENT_PAGE_FAULT_EXIT
+  init_event(struct page_fault_exit_event, EVENT_PAGE_FAULT_EXIT, event);
+  event->address = address;
+  event->flags = flags;
+  finish_event();
+#endif
+}
+
 static inline void event_log_wake_lock(void* lock, long timeout) {
 #ifdef CONFIG_EVENT_WAKE_LOCK
   init_event(struct wake_lock_event, EVENT_WAKE_LOCK, event);
@@ -571,6 +946,74 @@ static inline void event_log_mutex_notify(void* lock, pid_t pid) {
 #endif
 }
 
+/* write is non-zero for down_write() waiters, zero for down_read() */
+static inline void event_log_rwsem_wait(void* sem, int write) {
+#ifdef CONFIG_EVENT_RWSEM_WAIT
+  event_log_general_lock(write ? EVENT_RWSEM_WRITE_WAIT : EVENT_RWSEM_READ_WAIT, sem);
+#endif
+}
+
+static inline void event_log_rwsem_wake(void* sem, int write) {
+#ifdef CONFIG_EVENT_RWSEM_WAKE
+  event_log_general_lock(write ? EVENT_RWSEM_WRITE_WAKE : EVENT_RWSEM_READ_WAKE, sem);
+#endif
+}
+
+static inline void event_log_rwsem_notify(void* sem, int write, pid_t pid) {
+#ifdef CONFIG_EVENT_RWSEM_NOTIFY
+  event_log_general_notify(write ? EVENT_RWSEM_WRITE_NOTIFY : EVENT_RWSEM_READ_NOTIFY, sem, pid);
+#endif
+}
+
+static inline void event_log_rtmutex_wait(void* lock) {
+#ifdef CONFIG_EVENT_RTMUTEX_WAIT
+  event_log_general_lock(EVENT_RTMUTEX_WAIT, lock);
+#endif
+}
+
+static inline void event_log_rtmutex_wake(void* lock) {
+#ifdef CONFIG_EVENT_RTMUTEX_WAKE
+  event_log_general_lock(EVENT_RTMUTEX_WAKE, lock);
+#endif
+}
+
+static inline void event_log_rtmutex_notify(void* lock, pid_t pid) {
+#ifdef CONFIG_EVENT_RTMUTEX_NOTIFY
+  event_log_general_notify(EVENT_RTMUTEX_NOTIFY, lock, pid);
+#endif
+}
+
+static inline void event_log_epoll_wait(void* ep) {
+#ifdef CONFIG_EVENT_EPOLL_WAIT
+  event_log_general_lock(EVENT_EPOLL_WAIT, ep);
+#endif
+}
+
+static inline void event_log_epoll_wake(void* ep) {
+#ifdef CONFIG_EVENT_EPOLL_WAKE
+  event_log_general_lock(EVENT_EPOLL_WAKE, ep);
+#endif
+}
+
+static inline void event_log_epoll_notify(void* ep, pid_t pid, int fd) {
+#ifdef CONFIG_EVENT_EPOLL_NOTIFY
+  init_event(struct epoll_notify_event, EVENT_EPOLL_NOTIFY, event);
+  event->epoll = (__le32) ep;
+  event->pid = pid;
+  event->fd = fd;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_epoll_return(void* ep, int ready) {
+#ifdef CONFIG_EVENT_EPOLL_RETURN
+  init_event(struct epoll_return_event, EVENT_EPOLL_RETURN, event);
+  event->epoll = (__le32) ep;
+  event->ready = ready;
+  finish_event();
+#endif
+}
+
 static inline void event_log_futex_wait(void* lock) {
 #ifdef CONFIG_EVENT_FUTEX_WAIT
   event_log_general_lock(EVENT_FUTEX_WAIT, lock);
@@ -578,7 +1021,7 @@ static inline void event_log_futex_wait(void* lock) {
 }
 
 static inline void event_log_futex_wake(void* lock) {
-#ifdef CONFIG_EVENT_MUTEX_WAKE
+#ifdef CONFIG_EVENT_FUTEX_WAKE
   event_log_general_lock(EVENT_FUTEX_WAKE, lock);
 #endif
 }
@@ -602,8 +1045,8 @@ static inline void event_log_sem_wait(void* lock) {
 }
 
 static inline void event_log_sem_wake(void* lock) {
-#ifdef CONFIG_EVENT_SEMAPHORE_WAIT
-  event_log_general_lock(EVENT_SEMAPHORE_WAIT, lock);
+#ifdef CONFIG_EVENT_SEMAPHORE_WAKE
+  event_log_general_lock(EVENT_SEMAPHORE_WAKE, lock);
 #endif
 }
 
@@ -650,5 +1093,174 @@ static inline void event_log_cpufreq_timer(unsigned int cpu) {
 #endif
 }
 
+static inline void event_log_input_event(int dev, unsigned int type, unsigned int code, int value) {
+#ifdef CONFIG_EVENT_INPUT_EVENT
+  init_event(struct input_event_event, EVENT_INPUT_EVENT, event);
+  event->dev = dev;
+  event->type = type;
+  event->code = code;
+  event->value = value;
+  finish_event();
+#endif
+}
+
+static inline void event_log_input_read(int dev, unsigned int count) {
+#ifdef CONFIG_EVENT_INPUT_READ
+  init_event(struct input_read_event, EVENT_INPUT_READ, event);
+  event->dev = dev;
+  event->count = count;
+  finish_event();
+#endif
+}
+
+/* The interrupt events don't poke the queues, to keep them cheap */
+static inline void event_log_hardirq_entry(unsigned int irq) {
+#ifdef CONFIG_EVENT_HARDIRQ_ENTRY
+  init_event(struct hardirq_event, EVENT_HARDIRQ_ENTRY, event);
+  event->irq = irq;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_hardirq_exit(unsigned int irq) {
+#ifdef CONFIG_EVENT_HARDIRQ_EXIT
+  init_event(struct hardirq_event, EVENT_HARDIRQ_EXIT, event);
+  event->irq = irq;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_softirq_entry(unsigned int vec) {
+#ifdef CONFIG_EVENT_SOFTIRQ_ENTRY
+  init_event(struct softirq_event, EVENT_SOFTIRQ_ENTRY, event);
+  event->vec = vec;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_softirq_exit(unsigned int vec) {
+#ifdef CONFIG_EVENT_SOFTIRQ_EXIT
+  init_event(struct softirq_event, EVENT_SOFTIRQ_EXIT, event);
+  event->vec = vec;
+  finish_event_no_poke();
+#endif
+}
+
+/* Queueing happens under the gcwq lock, so it must not poke the queues */
+static inline void event_log_work_queue(void* work, void* func) {
+#ifdef CONFIG_EVENT_WORK_QUEUE
+  init_event(struct work_event, EVENT_WORK_QUEUE, event);
+  event->work = (__le32) work;
+  event->func = (__le32) func;
+  finish_event_no_poke();
+#endif
+}
+
+static inline void event_log_work_start(void* work, void* func) {
+#ifdef CONFIG_EVENT_WORK_START
+  init_event(struct work_event, EVENT_WORK_START, event);
+  event->work = (__le32) work;
+  event->func = (__le32) func;
+  finish_event();
+#endif
+}
+
+/* The work may already be freed; only its address is recorded */
+static inline void event_log_work_end(void* work, void* func) {
+#ifdef CONFIG_EVENT_WORK_END
+  init_event(struct work_event, EVENT_WORK_END, event);
+  event->work = (__le32) work;
+  event->func = (__le32) func;
+  finish_event();
+#endif
+}
+
+static inline void event_log_reclaim_begin(int order) {
+#ifdef CONFIG_EVENT_RECLAIM_BEGIN
+  init_event(struct reclaim_begin_event, EVENT_RECLAIM_BEGIN, event);
+  event->order = order;
+  finish_event();
+#endif
+}
+
+static inline void event_log_reclaim_end(unsigned long scanned, unsigned long reclaimed) {
+#ifdef CONFIG_EVENT_RECLAIM_END
+  init_event(struct reclaim_end_event, EVENT_RECLAIM_END, event);
+  event->scanned = scanned;
+  event->reclaimed = reclaimed;
+  finish_event();
+#endif
+}
+
+static inline void event_log_kswapd_wake(int node, int order) {
+#ifdef CONFIG_EVENT_KSWAPD_WAKE
+  init_event(struct kswapd_event, EVENT_KSWAPD_WAKE, event);
+  event->node = node;
+  event->order = order;
+  finish_event();
+#endif
+}
+
+static inline void event_log_kswapd_sleep(int node) {
+#ifdef CONFIG_EVENT_KSWAPD_SLEEP
+  init_event(struct kswapd_event, EVENT_KSWAPD_SLEEP, event);
+  event->node = node;
+  event->order = 0;
+  finish_event();
+#endif
+}
+
+#if defined(CONFIG_EVENT_FSYNC_BEGIN) || defined(CONFIG_EVENT_FSYNC_END)
+static inline void event_log_fsync(u8 event_type, dev_t dev, unsigned long inode, u8 flags) {
+  init_event(struct fsync_event, event_type, event);
+  event->dev = dev;
+  event->inode = inode;
+  event->flags = flags;
+  finish_event();
+}
+#endif
+
+static inline void event_log_fsync_begin(dev_t dev, unsigned long inode, int datasync) {
+#ifdef CONFIG_EVENT_FSYNC_BEGIN
+  event_log_fsync(EVENT_FSYNC_BEGIN, dev, inode, datasync ? FSYNC_DATASYNC : 0);
+#endif
+}
+
+static inline void event_log_fsync_end(dev_t dev, unsigned long inode, int datasync, int ret) {
+#ifdef CONFIG_EVENT_FSYNC_END
+  event_log_fsync(EVENT_FSYNC_END, dev, inode,
+		  (datasync ? FSYNC_DATASYNC : 0) | (ret ? FSYNC_ERROR : 0));
+#endif
+}
+
+static inline void event_log_journal_commit_start(dev_t dev, u32 tid) {
+#ifdef CONFIG_EVENT_JOURNAL_COMMIT_START
+  init_event(struct journal_commit_start_event, EVENT_JOURNAL_COMMIT_START, event);
+  event->dev = dev;
+  event->tid = tid;
+  finish_event();
+#endif
+}
+
+static inline void event_log_journal_commit_end(dev_t dev, u32 tid, u32 blocks) {
+#ifdef CONFIG_EVENT_JOURNAL_COMMIT_END
+  init_event(struct journal_commit_end_event, EVENT_JOURNAL_COMMIT_END, event);
+  event->dev = dev;
+  event->tid = tid;
+  event->blocks = blocks;
+  finish_event();
+#endif
+}
+
+static inline void event_log_lowmem_kill(pid_t pid, int oom_adj, int tasksize) {
+#ifdef CONFIG_EVENT_LOWMEM_KILL
+  init_event(struct lowmem_kill_event, EVENT_LOWMEM_KILL, event);
+  event->pid = pid;
+  event->oom_adj = oom_adj;
+  event->tasksize = tasksize;
+  finish_event();
+#endif
+}
+
 #endif // __KERNEL__
 #endif // EVENTLOGGING_EVENTS_H
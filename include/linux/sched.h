@@ -1502,6 +1502,12 @@ struct task_struct {
 	struct list_head pi_state_list;
 	struct futex_pi_state *pi_state_cache;
 #endif
+#ifdef CONFIG_EVENT_LOGGING_AGGREGATE
+	/* Lock wait being timed by the event logger's aggregation mode */
+	u64 el_wait_start;
+	void *el_wait_obj;
+	u8 el_wait_type;
+#endif
 #ifdef CONFIG_PERF_EVENTS
 	struct perf_event_context *perf_event_ctxp[perf_nr_task_contexts];
 	struct mutex perf_event_mutex;
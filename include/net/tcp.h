@@ -46,6 +46,8 @@
 
 #include <linux/seq_file.h>
 
+#include <eventlogging/events.h>
+
 extern struct inet_hashinfo tcp_hashinfo;
 
 extern struct percpu_counter tcp_orphan_count;
@@ -916,6 +918,8 @@ static inline int tcp_prequeue(struct sock *sk, struct sk_buff *skb)
 
 		tp->ucopy.memory = 0;
 	} else if (skb_queue_len(&tp->ucopy.prequeue) == 1) {
+		/* Bypasses sk_data_ready(), so log the wakeup here too */
+		event_log_sock_data_ready(sk, skb->len);
 		wake_up_interruptible_sync_poll(sk_sleep(sk),
 					   POLLIN | POLLRDNORM | POLLRDBAND);
 		if (!inet_csk_ack_scheduled(sk))
@@ -0,0 +1,354 @@
+#include <linux/kernel.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/smp.h>
+#include <linux/cpu.h>
+#include <linux/hash.h>
+#include <linux/ktime.h>
+#include <linux/spinlock.h>
+#include <linux/vmalloc.h>
+#include <linux/proc_fs.h>
+#include <linux/seq_file.h>
+#include <linux/string.h>
+
+#include <asm/uaccess.h>
+
+#include <eventlogging/events.h>
+
+#include "aggregate.h"
+
+/*
+ * In aggregation mode, lock wait/wake and binder events are not logged.
+ * Instead, lock waits are matched with their wakes and binder transactions with their
+ * consumption, and the latency is folded into a per-cpu log2 histogram
+ * keyed by (event type, object).  The object is the lock address for
+ * waits and (producer tgid << 16 | consumer tgid) for binder.  Every
+ * other event, including the stream records, is still logged as usual.
+ */
+
+#define AGG_TABLE_BITS 8
+#define AGG_TABLE_SIZE (1 << AGG_TABLE_BITS)
+#define AGG_PROBES 8
+#define AGG_BUCKETS 24  // bucket i counts latencies in [2^(i-1), 2^i) usec
+
+#define AGG_PENDING_BITS 6
+#define AGG_PENDING_SIZE (1 << AGG_PENDING_BITS)
+
+struct agg_entry {
+  u32 object;
+  u8 event_type;
+  u32 count;                 // 0 if the entry is unused
+  u64 total_us;
+  u32 hist[AGG_BUCKETS];
+};
+
+struct agg_table {
+  unsigned int overflow;     // latencies dropped because the table was full
+  struct agg_entry entries[AGG_TABLE_SIZE];
+};
+
+/* A binder transaction waiting to be consumed */
+struct agg_pending {
+  void* transaction;
+  u64 start_us;
+  u16 producer;
+  u8 event_type;
+};
+
+int event_log_aggregating __read_mostly;
+
+/* Waits started before aggregation was last turned on or reset are ignored */
+static u64 agg_epoch_us __read_mostly;
+
+static DEFINE_PER_CPU(struct agg_table*, agg_tables);
+
+static DEFINE_SPINLOCK(pending_lock);
+static struct agg_pending pending[AGG_PENDING_SIZE];
+static unsigned int unmatched;
+
+#define PFS_AGG_NAME "event_logging_agg"
+#define PFS_AGG_COMMAND_LEN 10
+#define PFS_AGG_ON "on"
+#define PFS_AGG_OFF "off"
+#define PFS_AGG_RESET "reset"
+#define PFS_AGG_PERMS S_IFREG|S_IROTH|S_IRGRP|S_IRUSR|S_IWOTH|S_IWGRP|S_IWUSR
+
+static inline u64 agg_now(void) {
+  return ktime_to_us(ktime_get());
+}
+
+static inline int agg_bucket(u64 us) {
+  int bucket = (us >> 32) ? 33 : fls((u32) us);
+  return min(bucket, AGG_BUCKETS - 1);
+}
+
+static void agg_record(u8 event_type, u32 object, u64 us) {
+  struct agg_table* table;
+  struct agg_entry* entry;
+  unsigned long flags;
+  unsigned int idx;
+  int i;
+
+  local_irq_save(flags);
+  table = __get_cpu_var(agg_tables);
+  if (!table)
+    goto out;
+
+  idx = hash_32(object ^ ((u32) event_type << 24), AGG_TABLE_BITS);
+  for (i = 0; i < AGG_PROBES; ++i) {
+    entry = &table->entries[(idx + i) & (AGG_TABLE_SIZE - 1)];
+    if (!entry->count) {
+      entry->object = object;
+      entry->event_type = event_type;
+      break;
+    }
+    if (entry->object == object && entry->event_type == event_type)
+      break;
+  }
+
+  if (i == AGG_PROBES) {
+    table->overflow++;
+    goto out;
+  }
+
+  entry->count++;
+  entry->total_us += us;
+  entry->hist[agg_bucket(us)]++;
+
+ out:
+  local_irq_restore(flags);
+}
+
+void event_agg_lock(u8 event_type, void* lock) {
+  struct task_struct* task = current;
+
+  switch (event_type) {
+  case EVENT_SEMAPHORE_WAIT:
+  case EVENT_FUTEX_WAIT:
+  case EVENT_MUTEX_WAIT:
+  case EVENT_WAITQUEUE_WAIT:
+  case EVENT_EPOLL_WAIT:
+  case EVENT_RWSEM_READ_WAIT:
+  case EVENT_RWSEM_WRITE_WAIT:
+  case EVENT_RTMUTEX_WAIT:
+    /* A wait that never saw its wake is dropped, not extended */
+    task->el_wait_type = event_type;
+    task->el_wait_obj = lock;
+    task->el_wait_start = agg_now();
+    break;
+  case EVENT_SEMAPHORE_WAKE:
+  case EVENT_FUTEX_WAKE:
+  case EVENT_MUTEX_WAKE:
+  case EVENT_WAITQUEUE_WAKE:
+  case EVENT_EPOLL_WAKE:
+  case EVENT_RWSEM_READ_WAKE:
+  case EVENT_RWSEM_WRITE_WAKE:
+  case EVENT_RTMUTEX_WAKE:
+    /* Each WAKE type directly follows its WAIT type */
+    if (task->el_wait_type + 1 == event_type && task->el_wait_obj == lock &&
+	task->el_wait_start >= ACCESS_ONCE(agg_epoch_us))
+      agg_record(task->el_wait_type, (u32) lock, agg_now() - task->el_wait_start);
+    task->el_wait_type = 0;
+    break;
+  }
+}
+
+void event_agg_binder(u8 event_type, void* transaction) {
+  struct agg_pending* slot;
+  struct agg_pending match;
+  unsigned long flags;
+  u64 now = agg_now();
+
+  match.transaction = NULL;
+
+  spin_lock_irqsave(&pending_lock, flags);
+  slot = &pending[hash_ptr(transaction, AGG_PENDING_BITS)];
+  if (EVENT_BINDER_CONSUME != event_type) {
+    /* Overwrites any older transaction that was never consumed */
+    slot->transaction = transaction;
+    slot->start_us = now;
+    slot->producer = current->tgid;
+    slot->event_type = event_type;
+  } else if (slot->transaction == transaction) {
+    match = *slot;
+    slot->transaction = NULL;
+  } else {
+    unmatched++;
+  }
+  spin_unlock_irqrestore(&pending_lock, flags);
+
+  if (match.transaction)
+    agg_record(match.event_type, ((u32) match.producer << 16) | (current->tgid & 0xFFFF),
+	       now - match.start_us);
+}
+
+static void __agg_reset_cpu(void* info) {
+  struct agg_table* table = __get_cpu_var(agg_tables);
+  unsigned long flags;
+
+  local_irq_save(flags);
+  if (table)
+    memset(table, 0, sizeof(*table));
+  local_irq_restore(flags);
+}
+
+static void agg_reset(void) {
+  int cpu;
+  unsigned long flags;
+
+  /* Offline cpus can't record, so they are cleared directly */
+  get_online_cpus();
+  on_each_cpu(__agg_reset_cpu, NULL, 1);
+  for_each_cpu_not(cpu, cpu_online_mask) {
+    if (per_cpu(agg_tables, cpu))
+      memset(per_cpu(agg_tables, cpu), 0, sizeof(struct agg_table));
+  }
+  put_online_cpus();
+
+  spin_lock_irqsave(&pending_lock, flags);
+  memset(pending, 0, sizeof(pending));
+  unmatched = 0;
+  spin_unlock_irqrestore(&pending_lock, flags);
+  agg_epoch_us = agg_now();
+}
+
+/* ============================= Proc FS Methods ============================= */
+
+/* The entry being shown and the cpu whose table it is in */
+struct agg_iter {
+  int cpu;
+  struct agg_entry* entry;
+};
+
+/* The position is (cpu * AGG_TABLE_SIZE + slot) + 1, with 0 the header line. */
+static void* agg_seq_next_entry(struct seq_file* m, loff_t* pos) {
+  struct agg_iter* iter = m->private;
+  struct agg_table* table;
+  struct agg_entry* entry;
+  unsigned int idx;
+  int cpu, slot;
+
+  for (; *pos <= nr_cpu_ids * AGG_TABLE_SIZE; ++*pos) {
+    if (0 == *pos)
+      return SEQ_START_TOKEN;
+    idx = *pos - 1;
+    cpu = idx >> AGG_TABLE_BITS;
+    slot = idx & (AGG_TABLE_SIZE - 1);
+    if (!cpu_possible(cpu) || !(table = per_cpu(agg_tables, cpu)))
+      continue;
+    entry = &table->entries[slot];
+    if (entry->count) {
+      iter->cpu = cpu;
+      iter->entry = entry;
+      return iter;
+    }
+  }
+  return NULL;
+}
+
+static void* agg_seq_start(struct seq_file* m, loff_t* pos) {
+  return agg_seq_next_entry(m, pos);
+}
+
+static void* agg_seq_next(struct seq_file* m, void* v, loff_t* pos) {
+  ++*pos;
+  return agg_seq_next_entry(m, pos);
+}
+
+static void agg_seq_stop(struct seq_file* m, void* v) {
+}
+
+static int agg_seq_show(struct seq_file* m, void* v) {
+  struct agg_iter* iter = v;
+  struct agg_entry* entry;
+  unsigned int overflow = 0;
+  unsigned int nr_unmatched;
+  unsigned long flags;
+  int cpu, i;
+
+  if (SEQ_START_TOKEN == v) {
+    for_each_possible_cpu(cpu) {
+      if (per_cpu(agg_tables, cpu))
+	overflow += per_cpu(agg_tables, cpu)->overflow;
+    }
+    spin_lock_irqsave(&pending_lock, flags);
+    nr_unmatched = unmatched;
+    spin_unlock_irqrestore(&pending_lock, flags);
+    seq_printf(m, "# overflow %u unmatched %u buckets %d\n", overflow, nr_unmatched, AGG_BUCKETS);
+    seq_printf(m, "# cpu type object count total_us hist...\n");
+    return 0;
+  }
+
+  entry = iter->entry;
+  seq_printf(m, "%d %u %08x %u %llu", iter->cpu, entry->event_type, entry->object,
+	     entry->count, (unsigned long long) entry->total_us);
+  for (i = 0; i < AGG_BUCKETS; ++i)
+    seq_printf(m, " %u", entry->hist[i]);
+  seq_putc(m, '\n');
+  return 0;
+}
+
+static const struct seq_operations agg_seq_ops = {
+  .start = agg_seq_start,
+  .next  = agg_seq_next,
+  .stop  = agg_seq_stop,
+  .show  = agg_seq_show,
+};
+
+static int agg_pfs_open(struct inode* inode, struct file* file) {
+  return seq_open_private(file, &agg_seq_ops, sizeof(struct agg_iter));
+}
+
+static ssize_t agg_pfs_write(struct file* file, const char __user* buffer, size_t count, loff_t* ppos) {
+  char command[PFS_AGG_COMMAND_LEN+1];
+  size_t len = min(count, (size_t) PFS_AGG_COMMAND_LEN);
+
+  if (!count)
+    return 0;
+
+  memset(command, 0, sizeof(command));
+  if ( copy_from_user(command, buffer, len) )
+    return -EFAULT;
+  strim(command);
+
+  if ( 0 == strcmp(command, PFS_AGG_ON) ) {
+    agg_epoch_us = agg_now();
+    smp_wmb();
+    event_log_aggregating = 1;
+  }
+  else if ( 0 == strcmp(command, PFS_AGG_OFF) ) {
+    event_log_aggregating = 0;
+  }
+  else if ( 0 == strcmp(command, PFS_AGG_RESET) ) {
+    agg_reset();
+  }
+  else {
+    return -EINVAL;
+  }
+
+  return count;
+}
+
+static const struct file_operations agg_pfs_fops = {
+  .open    = agg_pfs_open,
+  .read    = seq_read,
+  .write   = agg_pfs_write,
+  .llseek  = seq_lseek,
+  .release = seq_release_private,
+};
+
+__init int init_aggregate(void) {
+  struct proc_dir_entry* entry;
+  int cpu;
+
+  for_each_possible_cpu(cpu) {
+    per_cpu(agg_tables, cpu) = vzalloc(sizeof(struct agg_table));
+    if (!per_cpu(agg_tables, cpu))
+      printk(KERN_ERR "eventlogging: failed to allocate aggregation table for CPU %d\n", cpu);
+  }
+
+  entry = proc_create(PFS_AGG_NAME, PFS_AGG_PERMS, NULL, &agg_pfs_fops);
+  if (!entry)
+    return -EINVAL;
+  return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef EVENT_LOGGING_AGGREGATE_H
+#define EVENT_LOGGING_AGGREGATE_H
+
+#ifdef CONFIG_EVENT_LOGGING_AGGREGATE
+__init int init_aggregate(void);
+#else
+static inline int init_aggregate(void) {
+  return 0;
+}
+#endif
+
+#endif
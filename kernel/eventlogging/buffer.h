@@ -7,11 +7,12 @@
 struct sbuffer {
   struct list_head list;
   struct work_struct work;
+  void* owner; // session the buffer belongs to
   int order;   // order of page allocation (2^order pages)
   void* start; // starting address
   void* end;   // last address in buffer
   void* rp;    // pointer to next byte to read
-  void* wp;    // pointer to next byte writer
+  void* wp;    // pointer to next byte writer, stale while held by a cpu
 };
 
 void sbuffer_print_empty(void);
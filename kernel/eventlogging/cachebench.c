@@ -0,0 +1,50 @@
+#include <linux/kernel.h>
+#include <linux/sched.h>
+#include <linux/err.h>
+#include <linux/perf_event.h>
+#include <asm/div64.h>
+
+#include <eventlogging/events.h>
+
+#include "cachebench.h"
+
+/*
+ * Measures the cache misses caused by logging, by counting the misses
+ * of the current task while it logs 'count' EVENT_BENCH records.  The
+ * result, in misses per thousand events, is printed to the kernel log.
+ * Run it while the other cpus are busy logging to include the cost of
+ * cross-cpu sharing.
+ */
+int event_log_cache_bench(unsigned int count) {
+  struct perf_event_attr attr = {
+    .type   = PERF_TYPE_HARDWARE,
+    .config = PERF_COUNT_HW_CACHE_MISSES,
+    .size   = sizeof(attr),
+    .pinned = 1,
+  };
+  struct perf_event* counter;
+  u64 enabled, running;
+  u64 before, after, misses;
+  unsigned int i;
+
+  if (!count)
+    return -EINVAL;
+
+  counter = perf_event_create_kernel_counter(&attr, -1, current, NULL);
+  if (IS_ERR(counter))
+    return PTR_ERR(counter);
+
+  before = perf_event_read_value(counter, &enabled, &running);
+  for (i = 0; i < count; ++i)
+    event_log_simple_no_poke(EVENT_BENCH);
+  after = perf_event_read_value(counter, &enabled, &running);
+  poke_queues();
+
+  perf_event_release_kernel(counter);
+
+  misses = (after - before) * 1000;
+  do_div(misses, count);
+  printk(KERN_INFO "eventlogging: %llu cache misses over %u events, %llu per 1000 events\n",
+	 (unsigned long long) (after - before), count, (unsigned long long) misses);
+  return 0;
+}
@@ -0,0 +1,14 @@
+#ifndef EVENT_LOGGING_CACHEBENCH_H
+#define EVENT_LOGGING_CACHEBENCH_H
+
+#include <linux/errno.h>
+
+#ifdef CONFIG_EVENT_LOGGING_CACHE_BENCH
+int event_log_cache_bench(unsigned int count);
+#else
+static inline int event_log_cache_bench(unsigned int count) {
+  return -EINVAL;
+}
+#endif
+
+#endif
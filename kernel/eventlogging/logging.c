@@ -6,6 +6,10 @@
 #include <linux/proc_fs.h>
 #include <linux/lzo.h>
 #include <linux/string.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/mutex.h>
+#include <linux/rcupdate.h>
 
 #include <asm/uaccess.h>
 
@@ -16,179 +20,592 @@
 #include "idle.h"
 #include "hotcpu.h"
 #include "cpufreq.h"
+#include "sampling.h"
+#include "aggregate.h"
+#include "cachebench.h"
 #include "queue.h"
 
 #define BUFFER_ORDER 10  // 2^10 = 4 MB with 4096 page size
 #define NUM_BUFFERS   8  // 8 * 4 MB = 32 MB total
 
-static DEFINE_PER_CPU(struct sbuffer*, cpu_buffers);
-static DEFINE_PER_CPU(unsigned int, missed_events);
+/* Sessions other than the default one allocate their buffers on start */
+#define NUM_SESSIONS 4
+#define SESSION_BUFFER_ORDER 8     // 2^8 = 1 MB with 4096 page size
+#define SESSION_NUM_BUFFERS  4     // default number of buffers
+#define SESSION_MAX_BUFFERS  16
 
-/* Timestamp from last packet */
-static DEFINE_PER_CPU(struct timeval, last_tv);
+#define ANCHOR_INTERVAL HZ  // jiffies between clock anchors on each cpu
 
-static DEFINE_QUEUE(empty_buffers);
-static DEFINE_QUEUE(full_buffers);
-static DEFINE_QUEUE(compressed_buffers);
+#define EVENT_TYPES 256
+
+/*
+ * An independent consumer of events.  Each session has its own event
+ * mask, process filter, buffer pool and reader.  Session 0 is read
+ * through /proc/event_logging and is always active; sessions 1 and up
+ * are read through /proc/event_logging<n> and must be started first.
+ */
+struct session {
+  int id;
+  int active;                               // receiving events
+  DECLARE_BITMAP(mask, EVENT_TYPES);        // event types logged
+  pid_t tgid;                               // only log this process, 0 for all
+  int num_buffers;                          // buffers allocated
+  struct queue empty_buffers;
+  struct queue full_buffers;
+  struct queue compressed_buffers;
+  struct mutex read_lock;
+  struct sbuffer* read_buffer;
+  struct sbuffer* compress_empty_buffer;
+  struct proc_dir_entry* pfs_entry;
+};
+
+static struct session sessions[NUM_SESSIONS];
+
+/* Bit n is set if sessions[n] is active */
+static unsigned long active_sessions __read_mostly;
+
+/* Non-zero if more than one session is active */
+int event_log_multi_session __read_mostly;
+
+static DEFINE_MUTEX(sessions_lock);
+
+/*
+ * Writer-side state of one session, touched on every event but only by
+ * its own cpu.  While a buffer is held here, its write pointer lives
+ * in 'wp' and the buffer's own 'wp' is stale; it is written back when
+ * the buffer is flushed.  This keeps the hot path off the sbuffer,
+ * whose list head and work_struct are modified by the queues and
+ * workqueue from other cpus.
+ */
+struct cpu_state {
+  struct sbuffer* buf;     // current buffer, NULL if none
+  void* wp;                // next byte to write in buf
+  void* end;               // end of buf
+  struct timeval last_tv;  // timestamp from last packet
+  unsigned int missed;     // events missed since last buffer
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+  unsigned long next_anchor;  // jiffies at which the next anchor is due
+  unsigned int anchor_gen;    // value of anchor_gen at the last anchor
+#endif
+} ____cacheline_aligned_in_smp;
+
+static DEFINE_PER_CPU_SHARED_ALIGNED(struct cpu_state, cpu_state[NUM_SESSIONS]);
+
+/*
+ * Where the record currently being written on this cpu goes.  A
+ * record is written to its first matching session and copied to the
+ * others in 'pending' when it is finished.  Like cpu_state, it is
+ * written on every event, so it gets a cacheline of its own.
+ */
+struct dispatch {
+  struct cpu_state* target;  // state of the session being written
+  unsigned long pending;     // sessions still to receive a copy
+  struct session* only;      // if set, log only to this session
+};
+
+static DEFINE_PER_CPU_SHARED_ALIGNED(struct dispatch, dispatch);
+
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+/* Bumped to make every cpu log an anchor, e.g., after resume */
+static unsigned int anchor_gen;
+#endif
 
 #define PFS_NAME "event_logging"
-#define PFS_COMMAND_LEN 10
+#define PFS_NAME_LEN 24
+#define PFS_COMMAND_LEN 32
 #define PFS_RESTART "restart"
 #define PFS_CLEAR "clear"
+#define PFS_SAMPLE "sample"  // sample <type> <n>: log 1 in n events of type
+#define PFS_LIMIT "limit"    // limit <type> <n>: log at most n events of type per second
+#define PFS_CACHEBENCH "cachebench"  // cachebench <n>: measure cache misses logging n events
+#define PFS_START "start"    // start [n]: start the session with n buffers
+#define PFS_STOP "stop"      // stop: stop the session and free its buffers
+#define PFS_MASK "mask"      // mask <type> <0|1>: stop or start logging events of type
+#define PFS_MASK_ALL "maskall"  // maskall <0|1>: stop or start logging all events
+#define PFS_FILTER "filter"  // filter <tgid>: only log this process, 0 for all
 #define PFS_PERMS S_IFREG|S_IROTH|S_IRGRP|S_IRUSR|S_IWOTH|S_IWGRP|S_IWUSR
-static struct proc_dir_entry* el_pfs_entry;
-static DEFINE_MUTEX(pfs_read_lock);
-static struct sbuffer* pfs_read_buffer;
 
 static DEFINE_MUTEX(compress_lock);
-static struct sbuffer* compress_empty_buffer;
 
-static void init_new_buffer(void) {
+static inline struct cpu_state* __session_cpu_state(struct session* session) {
+  return &__get_cpu_var(cpu_state)[session->id];
+}
+
+/* Must be called with interrupts disabled */
+static inline int session_wants(struct session* session, u8 event_type) {
+  /*
+   * Records describing the stream itself go to every session.  Bench
+   * records are ordinary events that just happen to share the range.
+   */
+  if (event_type < EVENT_CPU_ONLINE && event_type != EVENT_BENCH)
+    return 1;
+  return test_bit(event_type, session->mask) &&
+    (!session->tgid || session->tgid == current->tgid);
+}
+
+static void init_new_buffer(struct session* session, struct cpu_state* state);
+
+#ifdef CONFIG_EVENT_CLOCK_ANCHOR
+static void __log_anchor(struct session* session, struct cpu_state* state) {
+  struct dispatch* dispatch = &__get_cpu_var(dispatch);
+  struct session* only = dispatch->only;
+
+  state->next_anchor = jiffies + ANCHOR_INTERVAL;
+  state->anchor_gen = ACCESS_ONCE(anchor_gen);
+  dispatch->only = session;
+  event_log_clock_anchor();
+  dispatch->only = only;
+}
+
+static inline void check_anchor(struct session* session, struct cpu_state* state) {
+  if (unlikely(time_after_eq(jiffies, state->next_anchor) ||
+	       state->anchor_gen != ACCESS_ONCE(anchor_gen)))
+    __log_anchor(session, state);
+}
+
+void event_log_resync_clocks(void) {
+  anchor_gen++;
+  smp_wmb();
+}
+#else
+static inline void __log_anchor(struct session* session, struct cpu_state* state) {}
+static inline void check_anchor(struct session* session, struct cpu_state* state) {}
+#endif
+
+/* The records at the start of each buffer go to that buffer's session only */
+static void init_new_buffer(struct session* session, struct cpu_state* state) {
+  struct dispatch* dispatch = &__get_cpu_var(dispatch);
+  struct session* only = dispatch->only;
+
+  dispatch->only = session;
   event_log_sync();
-  if  (__get_cpu_var(missed_events) > 0)
-       event_log_missed_count(&__get_cpu_var(missed_events));
+  __log_anchor(session, state);
+  if  (state->missed > 0)
+       event_log_missed_count(&state->missed);
+  event_log_sample_records();
+  dispatch->only = only;
 }
 
-inline static struct sbuffer* __get_new_cpu_buffer(void) {
-  struct sbuffer* buf = queue_take_try(&empty_buffers);
+static struct sbuffer* __get_new_cpu_buffer(struct session* session, struct cpu_state* state) {
+  struct sbuffer* buf = queue_take_try(&session->empty_buffers);
   if (NULL == buf) 
     goto out;
-  __get_cpu_var(cpu_buffers) = buf;
-  init_new_buffer();
+  state->buf = buf;
+  state->wp = buf->wp;
+  state->end = buf->end;
+  init_new_buffer(session, state);
  out:
   return buf;
 }
 
-inline static struct sbuffer* __get_cpu_buffer(void) {
-  struct sbuffer* buf = __get_cpu_var(cpu_buffers);
-  if (NULL == buf) 
-    buf = __get_new_cpu_buffer();
+/* Returns the buffer to its owner, with the write pointer written back */
+static struct sbuffer* __release_cpu_buffer(struct cpu_state* state) {
+  struct sbuffer* buf = state->buf;
+  if (NULL != buf)
+    buf->wp = state->wp;
+  state->buf = NULL;
+  state->wp = NULL;
+  state->end = NULL;
   return buf;
 }
 
-static struct sbuffer* __flush_cpu_buffer(void) {
-  struct sbuffer* buf = __get_cpu_var(cpu_buffers);
+static struct sbuffer* __flush_cpu_buffer(struct session* session, struct cpu_state* state) {
+  struct sbuffer* buf = __release_cpu_buffer(state);
   if (NULL != buf)
-    queue_put(&full_buffers, buf);
-  __get_cpu_var(cpu_buffers) = NULL;
-  return __get_cpu_buffer();
+    queue_put(&session->full_buffers, buf);
+  return __get_new_cpu_buffer(session, state);
 }
 
 /* If not enough space, returns NULL and logs a missed event. */
-void* reserve_event(int len) {
-  struct sbuffer* buf;
+static void* __reserve_session_event(struct session* session, int len) {
+  struct cpu_state* state = __session_cpu_state(session);
   void* wp;
 
   /* Get buffer, if available */
-  buf = __get_cpu_buffer();
+  if (unlikely(NULL == state->buf))
+    __get_new_cpu_buffer(session, state);
+  else
+    check_anchor(session, state);
  check_buffer:
-  if (!buf) {
-    __get_cpu_var(missed_events)++;
+  if (unlikely(NULL == state->buf)) {
+    state->missed++;
     return NULL;
   }
 
-  wp = sbuffer_reserve(buf, len);
   /* if full, get new buffer */
-  if (!wp) {
-    buf = __flush_cpu_buffer();
+  if (unlikely(state->wp + len > state->end)) {
+    __flush_cpu_buffer(session, state);
     goto check_buffer;
   }
 
+  wp = state->wp;
+  state->wp += len;
   return wp;
 }
 
-static void schedule_compression(void);
+/*
+ * Reserves space for the record in the first session that wants it.
+ * The remaining sessions that want it get a copy in replicate_event().
+ * Must be called with interrupts disabled.
+ */
+void* reserve_event(u8 event_type, int len) {
+  struct dispatch* dispatch = &__get_cpu_var(dispatch);
+  unsigned long targets;
+  void* wp;
+  int id;
+
+  /* Only the default session, which is never stopped, is active */
+  if (likely(!event_log_multi_session && !dispatch->only)) {
+    if (!session_wants(&sessions[0], event_type))
+      return NULL;
+    wp = __reserve_session_event(&sessions[0], len);
+    if (wp) {
+      dispatch->target = __session_cpu_state(&sessions[0]);
+      dispatch->pending = 0;
+    }
+    return wp;
+  }
+
+  if (unlikely(dispatch->only)) {
+    targets = 1UL << dispatch->only->id;
+  } else {
+    unsigned long active = ACCESS_ONCE(active_sessions);
+    targets = 0;
+    while (active) {
+      id = __ffs(active);
+      active &= ~(1UL << id);
+      if (session_wants(&sessions[id], event_type))
+	targets |= 1UL << id;
+    }
+  }
+
+  while (targets) {
+    id = __ffs(targets);
+    targets &= ~(1UL << id);
+    wp = __reserve_session_event(&sessions[id], len);
+    if (wp) {
+      dispatch->target = __session_cpu_state(&sessions[id]);
+      dispatch->pending = targets;
+      return wp;
+    }
+  }
+  return NULL;
+}
+
+/*
+ * Copies the just finished record to the other sessions that want it,
+ * re-encoding its timestamp against each session's last record.
+ * Records with an absolute timestamp (diff == 0), such as clock
+ * anchors, are copied with it unchanged.  Must be called with
+ * interrupts disabled.
+ */
+void replicate_event(struct event_hdr* header, void* payload, int len, int diff) {
+  struct dispatch* dispatch = &__get_cpu_var(dispatch);
+  unsigned long pending = dispatch->pending;
+  struct timeval now = dispatch->target->last_tv;
+  struct timeval tv;
+  struct cpu_state* state;
+  struct event_hdr* copy;
+  u8 sec_len, usec_len;
+  char* p;
+  int id;
+
+  dispatch->pending = 0;
+  while (pending) {
+    id = __ffs(pending);
+    pending &= ~(1UL << id);
+
+    copy = __reserve_session_event(&sessions[id], sizeof(*copy) + 4 + 3 + len);
+    if (!copy)
+      continue;
+
+    state = __session_cpu_state(&sessions[id]);
+    if (diff) {
+      tv.tv_sec = now.tv_sec - state->last_tv.tv_sec;
+      tv.tv_usec = now.tv_usec - state->last_tv.tv_usec;
+      sec_len = vsize_sec(tv.tv_sec);
+      usec_len = vsize_usec(tv.tv_usec);
+      state->wp -= 4 + 3 - sec_len - usec_len;
+    } else {
+      tv = now;
+      sec_len = 4;
+      usec_len = 3;
+    }
+    state->last_tv = now;
+
+    p = (char*) (copy + 1);
+    memcpy(p, &tv.tv_sec, sec_len);
+    p += sec_len;
+    memcpy(p, &tv.tv_usec, usec_len);
+    p += usec_len;
+    memcpy(p, payload, len);
+    event_log_header_init(copy, sec_len, usec_len, header->event_type);
+  }
+}
+
+static void schedule_compression(struct session* session);
 
+/* Must be called with interrupts disabled */
 void poke_queues(void) {
-  schedule_compression();
+  unsigned long active = ACCESS_ONCE(active_sessions);
+  int id;
+
+  while (active) {
+    id = __ffs(active);
+    active &= ~(1UL << id);
+    schedule_compression(&sessions[id]);
+  }
 }
 
+/* Returns the specified number of bytes from the last reservation */
 void shrink_event(int len) {
-  struct sbuffer* buf;
-  buf = __get_cpu_buffer();
-  if (buf)
-    sbuffer_cancel(buf, len);
+  struct cpu_state* state = __get_cpu_var(dispatch).target;
+  if (state->buf)
+    state->wp -= len;
 }
 
 /* Returns a reference to the per-cpu timestamp of the last record */
 struct timeval* get_timestamp(void) {
-  return &__get_cpu_var(last_tv);
+  return &__get_cpu_var(dispatch).target->last_tv;
 }
 
 /*
  * Must be called with hotplugging disabled
  * and 'cpu' offline.
  */
-static void __flush_offline_cpu_buffer(int cpu) {
-  struct sbuffer* buf = per_cpu(cpu_buffers, cpu);
+static void __flush_offline_cpu_buffer(struct session* session, int cpu) {
+  struct sbuffer* buf;
   printk("eventlogging: flushing offline cpu: %d\n", cpu);
+  buf = __release_cpu_buffer(&per_cpu(cpu_state, cpu)[session->id]);
   if (NULL == buf)
     return;
-  queue_put(&full_buffers, buf); 
-  per_cpu(cpu_buffers, cpu) = NULL;
+  queue_put(&session->full_buffers, buf); 
 }
 
 /*
  * Must be called with hotplugging disabled.
  */
-static void __flush_offline_cpus(void) {
+static void __flush_offline_cpus(struct session* session) {
   int cpu;
   for_each_cpu_not(cpu, cpu_online_mask) {
-    __flush_offline_cpu_buffer(cpu);
+    __flush_offline_cpu_buffer(session, cpu);
   }
 }
 
 static void __flush_online_cpu(void* info) {
-  preempt_disable();
+  struct session* session = info;
+  struct sbuffer* buf;
+  unsigned long flags;
+
+  local_irq_save(flags);
   printk("eventlogging: flushing online cpu: %d\n", smp_processor_id());
-  __flush_cpu_buffer();
-  preempt_enable();
+  if (session->active) {
+    __flush_cpu_buffer(session, __session_cpu_state(session));
+  } else {
+    /* Stopped sessions don't get a new buffer */
+    buf = __release_cpu_buffer(__session_cpu_state(session));
+    if (NULL != buf)
+      queue_put(&session->full_buffers, buf);
+  }
+  local_irq_restore(flags);
 }
 
 /*
- * Might sleep, so must be called in sleepable context.
+ * Might sleep, so must be called in sleepable context.  Moves the
+ * current buffer of each cpu to the full queue and, if the session is
+ * active, gives each cpu a new one.
  */
-void flush_all_cpus(void) {
+static void flush_session(struct session* session) {
   get_online_cpus(); // Disable hotplugging
   preempt_disable();
 
-  on_each_cpu(__flush_online_cpu, NULL, 1); // Only runs on online cpus
-  __flush_offline_cpus();
+  on_each_cpu(__flush_online_cpu, session, 1); // Only runs on online cpus
+  __flush_offline_cpus(session);
 
   preempt_enable();
   put_online_cpus(); // Enable hotplugging
 }
 
-static __init int init_alloc_buffers(void) {
-  int i, cpu;
+/*
+ * Might sleep, so must be called in sleepable context.
+ */
+void flush_all_cpus(void) {
+  int id;
+  mutex_lock(&sessions_lock);
+  for (id = 0; id < NUM_SESSIONS; ++id) {
+    if (sessions[id].active)
+      flush_session(&sessions[id]);
+  }
+  mutex_unlock(&sessions_lock);
+}
+
+static int alloc_session_buffers(struct session* session, int num, unsigned int order, gfp_t gfp) {
+  int i;
   int cnt = 0;
-  
-  /* Allocate all buffers */
-  for(i = 0; i < NUM_BUFFERS; ++i) {
+
+  for(i = 0; i < num; ++i) {
     struct sbuffer* buf;
 
-    buf = (struct sbuffer*) kmalloc(sizeof(struct sbuffer), GFP_ATOMIC);
+    buf = (struct sbuffer*) kmalloc(sizeof(struct sbuffer), gfp);
     if (0 == buf) {
       printk("eventlogging: failed to allocate buffer\n");
       continue;
     }
+    if (sbuffer_init(buf, order)) {
+      printk("eventlogging: failed to allocate buffer pages\n");
+      kfree(buf);
+      continue;
+    }
 
     ++cnt;
-    sbuffer_init(buf, BUFFER_ORDER);
-    queue_put(&empty_buffers, buf);
+    buf->owner = session;
+    queue_put(&session->empty_buffers, buf);
+  }
+  session->num_buffers = cnt;
+  printk("eventlogging: allocated %d buffers for session %d\n", cnt, session->id);
+
+  /* Allocate empty buffer for compression */
+  session->compress_empty_buffer = queue_take_try(&session->empty_buffers);
+  if (!session->compress_empty_buffer) {
+    printk(KERN_ERR "eventlogging: failed to allocate empty buffer for compression\n");
+    return -ENOMEM;
+  }
+  return 0;
+}
+
+static int __free_queue(struct queue* queue) {
+  struct sbuffer* buf;
+  int cnt = 0;
+  while ( (buf = queue_take_try(queue)) ) {
+    sbuffer_free(buf);
+    kfree(buf);
+    ++cnt;
+  }
+  return cnt;
+}
+
+static void free_session_buffers(struct session* session) {
+  int cnt = 0;
+
+  cnt += __free_queue(&session->full_buffers);
+  cnt += __free_queue(&session->compressed_buffers);
+  cnt += __free_queue(&session->empty_buffers);
+  if (session->read_buffer) {
+    sbuffer_free(session->read_buffer);
+    kfree(session->read_buffer);
+    session->read_buffer = NULL;
+    ++cnt;
+  }
+  if (session->compress_empty_buffer) {
+    sbuffer_free(session->compress_empty_buffer);
+    kfree(session->compress_empty_buffer);
+    session->compress_empty_buffer = NULL;
+    ++cnt;
+  }
+  if (cnt != session->num_buffers)
+    printk(KERN_ERR "eventlogging: freed %d of %d buffers of session %d\n",
+	   cnt, session->num_buffers, session->id);
+  session->num_buffers = 0;
+}
+
+/* Must be called with sessions_lock held */
+static void __set_session_active(struct session* session, int active) {
+  session->active = active;
+  if (active)
+    set_bit(session->id, &active_sessions);
+  else
+    clear_bit(session->id, &active_sessions);
+  event_log_multi_session = hweight_long(active_sessions) > 1;
+}
+
+static int start_session(struct session* session, int num) {
+  int err = 0;
+
+  if (num < 2 || num > SESSION_MAX_BUFFERS)
+    return -EINVAL;
+
+  mutex_lock(&sessions_lock);
+  /* Sampling is global, so it would thin this session's events too */
+  if (session->active || 0 == session->id || event_log_sampling_configured()) {
+    err = -EBUSY;
+    goto out;
+  }
+
+  err = alloc_session_buffers(session, num, SESSION_BUFFER_ORDER, GFP_KERNEL);
+  if (err) {
+    free_session_buffers(session);
+    goto out;
+  }
+
+  bitmap_fill(session->mask, EVENT_TYPES);
+  session->tgid = 0;
+  smp_wmb();
+  __set_session_active(session, 1);
+  printk(KERN_INFO "eventlogging: started session %d\n", session->id);
+
+ out:
+  mutex_unlock(&sessions_lock);
+  return err;
+}
+
+/*
+ * Stops the session and frees its buffers.  A reader waiting for a
+ * buffer is woken and returns; any read in progress is waited for.
+ */
+static int stop_session(struct session* session) {
+  int err = 0;
+
+  mutex_lock(&sessions_lock);
+  if (!session->active || 0 == session->id) {
+    err = -EINVAL;
+    goto out;
+  }
+
+  __set_session_active(session, 0);
+  wake_up_interruptible(&session->compressed_buffers.wait);
+  mutex_lock(&session->read_lock);
+
+  /* Events are logged, and queues poked, with interrupts disabled,
+     so once this returns no cpu is writing to the session. */
+  synchronize_sched();
+
+  flush_session(session);
+  flush_scheduled_work();
+  free_session_buffers(session);
+  mutex_unlock(&session->read_lock);
+  printk(KERN_INFO "eventlogging: stopped session %d\n", session->id);
+
+ out:
+  mutex_unlock(&sessions_lock);
+  return err;
+}
+
+static __init int init_alloc_buffers(void) {
+  int id, cpu;
+
+  for (id = 0; id < NUM_SESSIONS; ++id) {
+    struct session* session = &sessions[id];
+    session->id = id;
+    init_queue(&session->empty_buffers);
+    init_queue(&session->full_buffers);
+    init_queue(&session->compressed_buffers);
+    mutex_init(&session->read_lock);
   }
-  printk("eventlogging: allocated %d buffers\n", cnt);
 
   /* Set up CPUs to grab new buffer on first event */
   for_each_cpu(cpu, cpu_possible_mask) {
-    per_cpu(cpu_buffers, cpu) = NULL; 
+    for (id = 0; id < NUM_SESSIONS; ++id)
+      per_cpu(cpu_state, cpu)[id].buf = NULL; 
+    per_cpu(dispatch, cpu).target = &per_cpu(cpu_state, cpu)[0];
     printk("eventlogging: prepare buffer for CPU %d\n", cpu);
   }
 
-  /* Allocate empty buffer for compression */
-  compress_empty_buffer = queue_take_try(&empty_buffers);
-  if (!compress_empty_buffer)
-    printk(KERN_ERR "eventlogging: failed to allocate empty buffer for compression\n");
+  /* The default session logs everything from boot */
+  alloc_session_buffers(&sessions[0], NUM_BUFFERS, BUFFER_ORDER, GFP_ATOMIC);
+  bitmap_fill(sessions[0].mask, EVENT_TYPES);
+  mutex_lock(&sessions_lock);
+  __set_session_active(&sessions[0], 1);
+  mutex_unlock(&sessions_lock);
 
   return 0;
 }
@@ -196,9 +613,10 @@ static __init int init_alloc_buffers(void) {
 /* ============================= Compression ================================ */
 static char lzo_work_mem[LZO1X_1_MEM_COMPRESS];
 
-static int compress_buffer(struct sbuffer* buf) {
+static int compress_buffer(struct session* session, struct sbuffer* buf) {
   int err;
   u32 compressed_len;
+  struct sbuffer* empty;
 
   err = mutex_lock_interruptible(&compress_lock);
   if (err)
@@ -206,25 +624,27 @@ static int compress_buffer(struct sbuffer* buf) {
 
   /* Try to get empty buffer, if one is not already available. This
      should never happen. */
-  if (!compress_empty_buffer && 
-      !(compress_empty_buffer = queue_take_try(&empty_buffers)))
+  err = -ENOMEM;
+  if (!session->compress_empty_buffer && 
+      !(session->compress_empty_buffer = queue_take_try(&session->empty_buffers)))
     goto out;
+  empty = session->compress_empty_buffer;
 
-  sbuffer_clear(compress_empty_buffer);
+  sbuffer_clear(empty);
 
   /* Reserve four bytes to record data size */
-  compress_empty_buffer->wp += 4;
+  empty->wp += 4;
 
-  compressed_len = compress_empty_buffer->end - compress_empty_buffer->start;
-  err = lzo1x_1_compress(buf->rp, (buf->wp - buf->rp), compress_empty_buffer->wp, &compressed_len, &lzo_work_mem);
+  compressed_len = empty->end - empty->start;
+  err = lzo1x_1_compress(buf->rp, (buf->wp - buf->rp), empty->wp, &compressed_len, &lzo_work_mem);
   if (err) {
     printk(KERN_ERR "eventlogging: error compressing buffer: %d", err);
     goto out;
   }
-  compress_empty_buffer->wp += compressed_len;
-  memcpy(compress_empty_buffer->start, &compressed_len, 4);
+  empty->wp += compressed_len;
+  memcpy(empty->start, &compressed_len, 4);
 
-  sbuffer_swap(compress_empty_buffer, buf);
+  sbuffer_swap(empty, buf);
   err = 0;
 
  out:
@@ -235,43 +655,47 @@ static int compress_buffer(struct sbuffer* buf) {
 static void compress_buffer_func(struct work_struct* work) {
   int ret;
   struct sbuffer* buf;
+  struct session* session;
   
   buf = container_of(work, struct sbuffer, work);
-  ret = compress_buffer(buf);  
+  session = buf->owner;
+  ret = compress_buffer(session, buf);  
   if (ret)
     goto err;
 
-  queue_put(&compressed_buffers, buf);
-  queue_poke(&compressed_buffers);
+  queue_put(&session->compressed_buffers, buf);
+  queue_poke(&session->compressed_buffers);
   return;
 
  err:
   printk("eventlogging: failed to compress buffer: %d", ret);
+  sbuffer_clear(buf);
+  queue_put(&session->empty_buffers, buf);
 }
 
-static void schedule_compression(void) {
+static void schedule_compression(struct session* session) {
   struct sbuffer* buf;
-  while( (buf = queue_take_try(&full_buffers)) ) {
+  while( (buf = queue_take_try(&session->full_buffers)) ) {
     INIT_WORK(&buf->work, compress_buffer_func);
     schedule_work(&buf->work);
   }
 }
 
 /* =========================== Proc FS Methods ============================== */
-static int event_logging_read_pfs_restart(void) {
+static int event_logging_read_pfs_restart(struct session* session) {
   int err;
 
-  err = mutex_lock_interruptible(&pfs_read_lock);
+  err = mutex_lock_interruptible(&session->read_lock);
   if (err)
     goto mutex_err;
 
   /* If read is incomplete, restart read of this buffer */
-  if (NULL != pfs_read_buffer && !sbuffer_empty(pfs_read_buffer)) {
+  if (NULL != session->read_buffer && !sbuffer_empty(session->read_buffer)) {
     printk(KERN_INFO "eventlogging: restarting read of buffer");
-    sbuffer_restart_read(pfs_read_buffer);
+    sbuffer_restart_read(session->read_buffer);
   }
 
-  mutex_unlock(&pfs_read_lock);
+  mutex_unlock(&session->read_lock);
   return 0;
 
  mutex_err:
@@ -282,17 +706,22 @@ static int event_logging_read_pfs_restart(void) {
  * Flush the current buffers and then remove all pending,
  * unread compressed buffers.
  */
-static int event_logging_read_pfs_clear(void) {
+static int event_logging_read_pfs_clear(struct session* session) {
   int err;
   struct sbuffer* buf;
   int cnt = 0;
 
-  err = mutex_lock_interruptible(&pfs_read_lock);
+  err = mutex_lock_interruptible(&session->read_lock);
   if (err)
     goto mutex_err;
 
+  if (!session->active) {
+    err = -EINVAL;
+    goto err;
+  }
+
   /* Flush all cpus */
-  flush_all_cpus();
+  flush_session(session);
 
   /* Remove all from full buffers queue. */
   /* TODO: This removal races with the poke_queues() method, so the
@@ -300,78 +729,122 @@ static int event_logging_read_pfs_clear(void) {
    * the compressed buffers queue.  It's unlikely so I haven't fixed
    * that yet.
    */
-  while( (buf = queue_take_try(&full_buffers)) ) {
+  while( (buf = queue_take_try(&session->full_buffers)) ) {
     ++cnt;
     sbuffer_clear(buf);
-    queue_put(&empty_buffers, buf);
+    queue_put(&session->empty_buffers, buf);
   }
 
   /* Return buffer currently being read to empty queue*/ 
-  if (NULL != pfs_read_buffer) {
+  if (NULL != session->read_buffer) {
     ++cnt;
-    sbuffer_clear(pfs_read_buffer);
-    queue_put(&empty_buffers, pfs_read_buffer);
-    pfs_read_buffer = NULL;
+    sbuffer_clear(session->read_buffer);
+    queue_put(&session->empty_buffers, session->read_buffer);
+    session->read_buffer = NULL;
   }
 
   /* Remove all from compressed buffers queue */
-  while ( (buf = queue_take_try(&compressed_buffers)) ) {
+  while ( (buf = queue_take_try(&session->compressed_buffers)) ) {
     ++cnt;
     sbuffer_clear(buf);
-    queue_put(&empty_buffers, buf);
+    queue_put(&session->empty_buffers, buf);
   }
   printk(KERN_INFO "eventlogging: cleared %d unread buffers", cnt);
 
-  mutex_unlock(&pfs_read_lock);
-  return 0;
-
+ err:
+  mutex_unlock(&session->read_lock);
  mutex_err:
   return err;
 }
 
 static int event_logging_read_pfs(char* page, char** start, off_t off, int count, int* eof, void* data) {
+  struct session* session = data;
   int err, len;
 
   len = 0;
   *start = page;
   *eof = 1;
 
-  err = mutex_lock_interruptible(&pfs_read_lock);
+  err = mutex_lock_interruptible(&session->read_lock);
   if (err)
-    goto err;
+    goto mutex_err;
+
+  /* Stopped sessions have no buffers to read */
+  if (!session->active)
+    goto out;
 
   while (len == 0) {
     /* Return now-empty buffer to empty queue */
-    if (NULL != pfs_read_buffer && sbuffer_empty(pfs_read_buffer)) {
-      sbuffer_clear(pfs_read_buffer);
-      queue_put(&empty_buffers, pfs_read_buffer);
-      pfs_read_buffer = NULL;
+    if (NULL != session->read_buffer && sbuffer_empty(session->read_buffer)) {
+      sbuffer_clear(session->read_buffer);
+      queue_put(&session->empty_buffers, session->read_buffer);
+      session->read_buffer = NULL;
     }
 
-    /* Get a new buffer from the full queue */
-    if (NULL == pfs_read_buffer) {
-      pfs_read_buffer = queue_take_interruptible(&compressed_buffers);
-      if (IS_ERR(pfs_read_buffer)) {
-	err = PTR_ERR(pfs_read_buffer);
-	pfs_read_buffer = NULL;
+    /* Get a new buffer from the full queue, unless the session stops */
+    if (NULL == session->read_buffer) {
+      err = wait_event_interruptible(session->compressed_buffers.wait,
+				     !queue_empty(&session->compressed_buffers) ||
+				     !session->active);
+      if (err)
 	goto err;
-      }
+      if (!session->active)
+	goto out;
+      session->read_buffer = queue_take_try(&session->compressed_buffers);
+      if (NULL == session->read_buffer)
+	continue;
     }
     
     /* Read from the buffer */
-    len += sbuffer_read(pfs_read_buffer, page, count);
+    len += sbuffer_read(session->read_buffer, page, count);
   }
   
-  mutex_unlock(&pfs_read_lock);
+ out:
+  mutex_unlock(&session->read_lock);
   return len;
 
   err:
-    mutex_unlock(&pfs_read_lock);
+    mutex_unlock(&session->read_lock);
+  mutex_err:
     return err;
 }
 
+/**
+ * Change the sampling of an event type and start new buffers, so the
+ * new configuration is recorded at the head of each.  Sampling applies
+ * to every session, so it can only be changed while just one is active.
+ */
+static int event_logging_write_pfs_sampling(int (*set)(unsigned int, u32), unsigned int type, u32 val) {
+  int err;
+
+  mutex_lock(&sessions_lock);
+  if (event_log_multi_session)
+    err = -EBUSY;
+  else
+    err = set(type, val);
+  mutex_unlock(&sessions_lock);
+  if (err)
+    return err;
+
+  flush_all_cpus();
+  return 0;
+}
+
+static int event_logging_write_pfs_mask(struct session* session, unsigned int type, unsigned int val) {
+  if (type >= EVENT_TYPES)
+    return -EINVAL;
+
+  if (val)
+    set_bit(type, session->mask);
+  else
+    clear_bit(type, session->mask);
+  return 0;
+}
+
 static int event_logging_write_pfs(struct file* file, const char* buffer, unsigned long count, void *data) {
+  struct session* session = data;
   int err;
+  unsigned int type, val;
   char command[PFS_COMMAND_LEN+1];
 
   if (!count)
@@ -386,19 +859,70 @@ static int event_logging_write_pfs(struct file* file, const char* buffer, unsign
 
   /* Process restart command */
   if ( 0 == strcmp(command, PFS_RESTART) ) {
-    err = event_logging_read_pfs_restart();
+    err = event_logging_read_pfs_restart(session);
     if (err)
       goto err;
   }
   /* Process clear command */
   else if (0 == strcmp(command, PFS_CLEAR) ) {
-    err = event_logging_read_pfs_clear();
+    err = event_logging_read_pfs_clear(session);
+    if (err)
+      goto err;
+  }
+  /* Process sample command */
+  else if (2 == sscanf(command, PFS_SAMPLE " %u %u", &type, &val) ) {
+    err = event_logging_write_pfs_sampling(event_log_set_sample_rate, type, val);
+    if (err)
+      goto err;
+  }
+  /* Process limit command */
+  else if (2 == sscanf(command, PFS_LIMIT " %u %u", &type, &val) ) {
+    err = event_logging_write_pfs_sampling(event_log_set_rate_limit, type, val);
+    if (err)
+      goto err;
+  }
+  /* Process cache benchmark command */
+  else if (1 == sscanf(command, PFS_CACHEBENCH " %u", &val) ) {
+    err = event_log_cache_bench(val);
+    if (err)
+      goto err;
+  }
+  /* Process start command */
+  else if (0 == strcmp(command, PFS_START) ) {
+    err = start_session(session, SESSION_NUM_BUFFERS);
+    if (err)
+      goto err;
+  }
+  else if (1 == sscanf(command, PFS_START " %u", &val) ) {
+    err = start_session(session, val);
+    if (err)
+      goto err;
+  }
+  /* Process stop command */
+  else if (0 == strcmp(command, PFS_STOP) ) {
+    err = stop_session(session);
     if (err)
       goto err;
   }
+  /* Process mask commands */
+  else if (1 == sscanf(command, PFS_MASK_ALL " %u", &val) ) {
+    if (val)
+      bitmap_fill(session->mask, EVENT_TYPES);
+    else
+      bitmap_zero(session->mask, EVENT_TYPES);
+  }
+  else if (2 == sscanf(command, PFS_MASK " %u %u", &type, &val) ) {
+    err = event_logging_write_pfs_mask(session, type, val);
+    if (err)
+      goto err;
+  }
+  /* Process filter command */
+  else if (1 == sscanf(command, PFS_FILTER " %u", &val) ) {
+    session->tgid = val;
+  }
   /* Process default command */
-  else {
-    flush_all_cpus();
+  else if (session->active) {
+    flush_session(session);
   }
 
   return count;
@@ -408,14 +932,27 @@ static int event_logging_write_pfs(struct file* file, const char* buffer, unsign
 }
 
 static __init int event_logging_create_pfs(void) {
-  el_pfs_entry = create_proc_entry(PFS_NAME, PFS_PERMS, NULL);
-  if (!el_pfs_entry)
-    goto err;
+  char name[PFS_NAME_LEN];
+  int id;
+
+  for (id = 0; id < NUM_SESSIONS; ++id) {
+    struct session* session = &sessions[id];
+
+    if (0 == id)
+      strcpy(name, PFS_NAME);
+    else
+      snprintf(name, sizeof(name), PFS_NAME "%d", id);
+
+    session->pfs_entry = create_proc_entry(name, PFS_PERMS, NULL);
+    if (!session->pfs_entry)
+      goto err;
   
-  el_pfs_entry->uid = 0;
-  el_pfs_entry->gid = 0;
-  el_pfs_entry->read_proc = event_logging_read_pfs;
-  el_pfs_entry->write_proc = event_logging_write_pfs;
+    session->pfs_entry->uid = 0;
+    session->pfs_entry->gid = 0;
+    session->pfs_entry->data = session;
+    session->pfs_entry->read_proc = event_logging_read_pfs;
+    session->pfs_entry->write_proc = event_logging_write_pfs;
+  }
   return 0;
 
  err:
@@ -429,5 +966,4 @@ early_initcall(init_idle_notifier);
 early_initcall(init_hotcpu_notifier);
 fs_initcall(init_cpufreq_notifier);
 fs_initcall(event_logging_create_pfs);
-
-
+fs_initcall(init_aggregate);
@@ -21,6 +21,12 @@ struct queue {
     .wait = __WAIT_QUEUE_HEAD_INITIALIZER(name.wait)	\
   }						 
 
+static inline void init_queue(struct queue* queue) {
+  INIT_LIST_HEAD(&queue->list);
+  spin_lock_init(&queue->lock);
+  init_waitqueue_head(&queue->wait);
+}
+
 static inline void queue_lock(struct queue* queue) {
   spin_lock_irqsave(&queue->lock, queue->flags);
 }
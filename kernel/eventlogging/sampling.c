@@ -0,0 +1,136 @@
+#include <linux/kernel.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+#include <linux/percpu.h>
+#include <linux/jiffies.h>
+#include <linux/mutex.h>
+
+#include <eventlogging/events.h>
+
+#include "sampling.h"
+
+#define EVENT_TYPES 256
+
+/* Record types below this one describe the stream itself (sync,
+ * missed counts, sampling) and are never sampled or limited.  Neither
+ * are clock anchors.
+ */
+#define FIRST_SAMPLED_TYPE EVENT_CPU_ONLINE
+
+static inline int sampled_type(unsigned int event_type) {
+  return event_type >= FIRST_SAMPLED_TYPE && event_type < EVENT_TYPES &&
+    event_type != EVENT_CLOCK_ANCHOR;
+}
+
+/* Non-zero if any event type has a sample rate or rate limit set */
+int event_log_sampling_active __read_mostly;
+
+/* Log 1 in sample_rate[type] events. 0 and 1 both mean log all. */
+static u32 sample_rate[EVENT_TYPES] __read_mostly;
+
+/* Log at most rate_limit[type] events per second per cpu. 0 means unlimited. */
+static u32 rate_limit[EVENT_TYPES] __read_mostly;
+
+/* Types with a sample rate or rate limit, so buffer heads skip the rest */
+static DECLARE_BITMAP(configured, EVENT_TYPES) __read_mostly;
+
+static DEFINE_MUTEX(config_lock);
+
+struct sample_state {
+  u32 skipped[EVENT_TYPES];               // events skipped since the last sampled one
+  u32 window_count[EVENT_TYPES];          // events logged in the current window
+  u32 dropped[EVENT_TYPES];               // events dropped by the limit, not yet reported
+  unsigned long window_end[EVENT_TYPES];  // jiffies at which the window ends
+  DECLARE_BITMAP(dropping, EVENT_TYPES);  // types with a non-zero 'dropped'
+};
+
+static DEFINE_PER_CPU(struct sample_state, sample_state);
+
+static void log_dropped(struct sample_state* state, u8 event_type) {
+  if (state->dropped[event_type]) {
+    event_log_rate_limited(event_type, state->dropped[event_type]);
+    state->dropped[event_type] = 0;
+  }
+  __clear_bit(event_type, state->dropping);
+}
+
+/*
+ * Must be called with interrupts disabled.  Returns non-zero if the
+ * event should be logged.
+ */
+int __event_log_sample(u8 event_type) {
+  struct sample_state* state = &__get_cpu_var(sample_state);
+  u32 rate = sample_rate[event_type];
+  u32 limit = rate_limit[event_type];
+
+  if (rate > 1) {
+    if (++state->skipped[event_type] < rate)
+      return 0;
+    state->skipped[event_type] = 0;
+  }
+
+  if (limit) {
+    if (time_after_eq(jiffies, state->window_end[event_type])) {
+      log_dropped(state, event_type);
+      state->window_end[event_type] = jiffies + HZ;
+      state->window_count[event_type] = 0;
+    }
+    if (state->window_count[event_type] >= limit) {
+      state->dropped[event_type]++;
+      __set_bit(event_type, state->dropping);
+      return 0;
+    }
+    state->window_count[event_type]++;
+  }
+
+  return 1;
+}
+
+/*
+ * Records the sampling configuration of every type that is not logged
+ * in full, and any drops not yet reported.  Called at the start of each
+ * buffer, so a decoder can rescale the counts of any buffer on its own.
+ * Must be called with interrupts disabled.
+ */
+void event_log_sample_records(void) {
+  struct sample_state* state = &__get_cpu_var(sample_state);
+  int type;
+
+  for_each_set_bit(type, configured, EVENT_TYPES)
+    event_log_sample_rate(type, max(sample_rate[type], 1U), rate_limit[type]);
+  for_each_set_bit(type, state->dropping, EVENT_TYPES)
+    log_dropped(state, type);
+}
+
+/* Must be called with config_lock held */
+static void __update_active(unsigned int event_type) {
+  if (sample_rate[event_type] > 1 || rate_limit[event_type])
+    set_bit(event_type, configured);
+  else
+    clear_bit(event_type, configured);
+  event_log_sampling_active = !bitmap_empty(configured, EVENT_TYPES);
+}
+
+int event_log_set_sample_rate(unsigned int event_type, u32 rate) {
+  if (!sampled_type(event_type))
+    return -EINVAL;
+
+  mutex_lock(&config_lock);
+  sample_rate[event_type] = rate;
+  __update_active(event_type);
+  mutex_unlock(&config_lock);
+  printk(KERN_INFO "eventlogging: sampling 1 in %u of type %u\n", rate, event_type);
+  return 0;
+}
+
+int event_log_set_rate_limit(unsigned int event_type, u32 limit) {
+  if (!sampled_type(event_type))
+    return -EINVAL;
+
+  mutex_lock(&config_lock);
+  rate_limit[event_type] = limit;
+  __update_active(event_type);
+  mutex_unlock(&config_lock);
+  printk(KERN_INFO "eventlogging: limiting type %u to %u per second\n", event_type, limit);
+  return 0;
+}
@@ -0,0 +1,31 @@
+#ifndef EVENT_LOGGING_SAMPLING_H
+#define EVENT_LOGGING_SAMPLING_H
+
+#include <linux/errno.h>
+#include <linux/types.h>
+
+#include <eventlogging/events.h>
+
+#ifdef CONFIG_EVENT_LOGGING_SAMPLING
+/* Non-zero if any event type is sampled or rate limited */
+static inline int event_log_sampling_configured(void) {
+  return event_log_sampling_active;
+}
+
+int event_log_set_sample_rate(unsigned int event_type, u32 rate);
+int event_log_set_rate_limit(unsigned int event_type, u32 limit);
+void event_log_sample_records(void);
+#else
+static inline int event_log_sampling_configured(void) {
+  return 0;
+}
+static inline int event_log_set_sample_rate(unsigned int event_type, u32 rate) {
+  return -EINVAL;
+}
+static inline int event_log_set_rate_limit(unsigned int event_type, u32 limit) {
+  return -EINVAL;
+}
+static inline void event_log_sample_records(void) {}
+#endif
+
+#endif
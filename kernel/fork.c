@@ -1228,6 +1228,11 @@ static struct task_struct *copy_process(unsigned long clone_flags,
 	p->memcg_batch.do_batch = 0;
 	p->memcg_batch.memcg = NULL;
 #endif
+#ifdef CONFIG_EVENT_LOGGING_AGGREGATE
+	p->el_wait_type = 0;	/* not waiting on anything yet */
+	p->el_wait_obj = NULL;
+	p->el_wait_start = 0;
+#endif
 
 	/* Perform scheduler related setup. Assign this task to a CPU. */
 	sched_fork(p);
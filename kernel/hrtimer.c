@@ -50,6 +50,8 @@
 
 #include <trace/events/timer.h>
 
+#include <eventlogging/events.h>
+
 /*
  * The timer bases:
  *
@@ -753,6 +755,7 @@ void clock_was_set(void)
 	on_each_cpu(retrigger_next_event, NULL, 1);
 #endif
 	timerfd_clock_was_set();
+	event_log_clock_was_set();
 }
 
 /*
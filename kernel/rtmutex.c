@@ -15,6 +15,8 @@
 #include <linux/sched.h>
 #include <linux/timer.h>
 
+#include <eventlogging/events.h>
+
 #include "rtmutex_common.h"
 
 /*
@@ -478,6 +480,7 @@ static void wakeup_next_waiter(struct rt_mutex *lock)
 
 	raw_spin_unlock_irqrestore(&current->pi_lock, flags);
 
+	event_log_rtmutex_notify(lock, waiter->task->pid);
 	wake_up_process(waiter->task);
 }
 
@@ -603,7 +606,9 @@ __rt_mutex_slowlock(struct rt_mutex *lock, int state,
 
 		debug_rt_mutex_print_deadlock(waiter);
 
+		event_log_rtmutex_wait(lock);
 		schedule_rt_mutex(lock);
+		event_log_rtmutex_wake(lock);
 
 		raw_spin_lock(&lock->wait_lock);
 		set_current_state(state);
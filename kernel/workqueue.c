@@ -42,6 +42,8 @@
 #include <linux/lockdep.h>
 #include <linux/idr.h>
 
+#include <eventlogging/events.h>
+
 #include "workqueue_sched.h"
 
 enum {
@@ -1035,6 +1037,7 @@ static void __queue_work(unsigned int cpu, struct workqueue_struct *wq,
 	/* gcwq determined, get cwq and queue */
 	cwq = get_cwq(gcwq->cpu, wq);
 	trace_workqueue_queue_work(cpu, cwq, work);
+	event_log_work_queue(work, work->func);
 
 	BUG_ON(!list_empty(&work->entry));
 
@@ -1867,12 +1870,14 @@ __acquires(&gcwq->lock)
 	lock_map_acquire_read(&cwq->wq->lockdep_map);
 	lock_map_acquire(&lockdep_map);
 	trace_workqueue_execute_start(work);
+	event_log_work_start(work, f);
 	f(work);
 	/*
 	 * While we must be careful to not use "work" after this, the trace
 	 * point will only record its address.
 	 */
 	trace_workqueue_execute_end(work);
+	event_log_work_end(work, f);
 	lock_map_release(&lockdep_map);
 	lock_map_release(&cwq->wq->lockdep_map);
 
@@ -9,6 +9,8 @@
 #include <linux/sched.h>
 #include <linux/module.h>
 
+#include <eventlogging/events.h>
+
 struct rwsem_waiter {
 	struct list_head list;
 	struct task_struct *task;
@@ -85,6 +87,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wakewrite)
 		/* Don't touch waiter after ->task has been NULLed */
 		smp_mb();
 		waiter->task = NULL;
+		event_log_rwsem_notify(sem, 1, tsk->pid);
 		wake_up_process(tsk);
 		put_task_struct(tsk);
 		goto out;
@@ -100,6 +103,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wakewrite)
 		tsk = waiter->task;
 		smp_mb();
 		waiter->task = NULL;
+		event_log_rwsem_notify(sem, 0, tsk->pid);
 		wake_up_process(tsk);
 		put_task_struct(tsk);
 		woken++;
@@ -131,6 +135,7 @@ __rwsem_wake_one_writer(struct rw_semaphore *sem)
 	tsk = waiter->task;
 	smp_mb();
 	waiter->task = NULL;
+	event_log_rwsem_notify(sem, 1, tsk->pid);
 	wake_up_process(tsk);
 	put_task_struct(tsk);
 	return sem;
@@ -171,7 +176,9 @@ void __sched __down_read(struct rw_semaphore *sem)
 	for (;;) {
 		if (!waiter.task)
 			break;
+		event_log_rwsem_wait(sem, 0);
 		schedule();
+		event_log_rwsem_wake(sem, 0);
 		set_task_state(tsk, TASK_UNINTERRUPTIBLE);
 	}
 
@@ -238,7 +245,9 @@ void __sched __down_write_nested(struct rw_semaphore *sem, int subclass)
 	for (;;) {
 		if (!waiter.task)
 			break;
+		event_log_rwsem_wait(sem, 1);
 		schedule();
+		event_log_rwsem_wake(sem, 1);
 		set_task_state(tsk, TASK_UNINTERRUPTIBLE);
 	}
 
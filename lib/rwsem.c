@@ -8,6 +8,8 @@
 #include <linux/init.h>
 #include <linux/module.h>
 
+#include <eventlogging/events.h>
+
 /*
  * Initialize an rwsem:
  */
@@ -94,6 +96,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 	tsk = waiter->task;
 	smp_mb();
 	waiter->task = NULL;
+	event_log_rwsem_notify(sem, 1, tsk->pid);
 	wake_up_process(tsk);
 	put_task_struct(tsk);
 	goto out;
@@ -148,6 +151,7 @@ __rwsem_do_wake(struct rw_semaphore *sem, int wake_type)
 		tsk = waiter->task;
 		smp_mb();
 		waiter->task = NULL;
+		event_log_rwsem_notify(sem, 0, tsk->pid);
 		wake_up_process(tsk);
 		put_task_struct(tsk);
 	}
@@ -210,7 +214,9 @@ rwsem_down_failed_common(struct rw_semaphore *sem,
 	for (;;) {
 		if (!waiter.task)
 			break;
+		event_log_rwsem_wait(sem, flags & RWSEM_WAITING_FOR_WRITE);
 		schedule();
+		event_log_rwsem_wake(sem, flags & RWSEM_WAITING_FOR_WRITE);
 		set_task_state(tsk, TASK_UNINTERRUPTIBLE);
 	}
 
@@ -49,6 +49,8 @@
 
 #include <linux/swapops.h>
 
+#include <eventlogging/events.h>
+
 #include "internal.h"
 
 #define CREATE_TRACE_POINTS
@@ -2095,6 +2097,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 
 	get_mems_allowed();
 	delayacct_freepages_start();
+	event_log_reclaim_begin(sc->order);
 
 	if (scanning_global_lru(sc))
 		count_vm_event(ALLOCSTALL);
@@ -2154,6 +2157,7 @@ static unsigned long do_try_to_free_pages(struct zonelist *zonelist,
 	}
 
 out:
+	event_log_reclaim_end(total_scanned, sc->nr_reclaimed);
 	delayacct_freepages_end();
 	put_mems_allowed();
 
@@ -2685,6 +2689,7 @@ static void kswapd_try_to_sleep(pg_data_t *pgdat, int order, int classzone_idx)
 	 */
 	if (!sleeping_prematurely(pgdat, order, remaining, classzone_idx)) {
 		trace_mm_vmscan_kswapd_sleep(pgdat->node_id);
+		event_log_kswapd_sleep(pgdat->node_id);
 
 		/*
 		 * vmstat counters are not perfectly accurate and the estimated
@@ -2794,6 +2799,7 @@ static int kswapd(void *p)
 		 */
 		if (!ret) {
 			trace_mm_vmscan_kswapd_wake(pgdat->node_id, order);
+			event_log_kswapd_wake(pgdat->node_id, order);
 			order = balance_pgdat(pgdat, order, &classzone_idx);
 		}
 	}
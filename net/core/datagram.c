@@ -115,9 +115,9 @@ static int wait_for_packet(struct sock *sk, int *err, long *timeo_p)
 		goto interrupted;
 
 	error = 0;
-	event_log_datagram_block();
+	event_log_datagram_block(sk);
 	*timeo_p = schedule_timeout(*timeo_p);
-	event_log_datagram_resume();
+	event_log_datagram_resume(sk);
 out:
 	finish_wait(sk_sleep(sk), &wait);
 	return error;
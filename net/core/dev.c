@@ -133,6 +133,7 @@
 #include <linux/pci.h>
 #include <linux/inetdevice.h>
 #include <linux/cpu_rmap.h>
+#include <eventlogging/events.h>
 
 #include "net-sysfs.h"
 
@@ -3103,6 +3104,7 @@ static int __netif_receive_skb(struct sk_buff *skb)
 		net_timestamp_check(skb);
 
 	trace_netif_receive_skb(skb);
+	event_log_net_rx(skb, skb->dev->ifindex, skb->len);
 
 	/* if we've gotten here through NAPI, check netpoll */
 	if (netpoll_receive_skb(skb))
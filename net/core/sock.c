@@ -1659,9 +1659,9 @@ int sk_wait_data(struct sock *sk, long *timeo)
 
 	prepare_to_wait(sk_sleep(sk), &wait, TASK_INTERRUPTIBLE);
 	set_bit(SOCK_ASYNC_WAITDATA, &sk->sk_socket->flags);
-	event_log_sock_block();
+	event_log_sock_block(sk);
 	rc = sk_wait_event(sk, timeo, !skb_queue_empty(&sk->sk_receive_queue));
-	event_log_sock_resume();
+	event_log_sock_resume(sk);
 	clear_bit(SOCK_ASYNC_WAITDATA, &sk->sk_socket->flags);
 	finish_wait(sk_sleep(sk), &wait);
 	return rc;
@@ -1910,6 +1910,8 @@ static void sock_def_readable(struct sock *sk, int len)
 {
 	struct socket_wq *wq;
 
+	event_log_sock_data_ready(sk, len);
+
 	rcu_read_lock();
 	wq = rcu_dereference(sk->sk_wq);
 	if (wq_has_sleeper(wq))